@@ -1,13 +1,48 @@
 #version 450 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec4 aOffset; // per instance: xyz offset, w scale (LOD only, otherwise 1); (0, 0, 0, 1) when not instanced
+layout (location = 3) in uint aPalette; // Lattice16 vertices: index into FaceColors
 
 out vec3 vColor;
 
 uniform mat4 MVP;
+uniform float Scale; // 2^-level when instanced, otherwise 1
+uniform float LatticeScale; // > 0: aPos holds lattice coordinates k1..k3 in units of 2^-level
+
+// Procedural mode: no attributes, the leaf comes from gl_InstanceID and the corner from gl_VertexID
+uniform int Level; // -1 = use the attributes above
+uniform vec3 BaseVertices[4];
+uniform vec3 FaceColors[4];
+
+// triangle order of a leaf tetra (red, black, blue, green), as in GasketGeometry::emitTetra
+const int LeafCorner[12] = int[12](0, 1, 2, 3, 2, 1, 0, 3, 1, 0, 2, 3);
+const int FaceColor[4] = int[4](0, 3, 2, 1);
 
 void main()
 {
-    gl_Position = MVP * vec4(aPos, 1.0);
-    vColor = aColor;
-}
\ No newline at end of file
+    if (Level < 0 && LatticeScale > 0.0) {
+        vec3 b0 = BaseVertices[0];
+        vec3 pos = b0 + LatticeScale * (aPos.x * (BaseVertices[1] - b0) + aPos.y * (BaseVertices[2] - b0) + aPos.z * (BaseVertices[3] - b0));
+        gl_Position = MVP * vec4(pos, 1.0);
+        vColor = FaceColors[aPalette];
+        return;
+    }
+    if (Level < 0) {
+        gl_Position = MVP * vec4(aPos * (Scale * aOffset.w) + aOffset.xyz, 1.0);
+        vColor = aColor;
+        return;
+    }
+
+    // base-4 digits of the leaf index, most significant first, are the corners picked at each split:
+    // child c of (scale s, offset t) is (s / 2, t + s / 2 * BaseVertices[c])
+    float s = 1.0;
+    vec3 offset = vec3(0.0);
+    for (int d = Level - 1; d >= 0; --d) {
+        s *= 0.5;
+        offset += s * BaseVertices[(gl_InstanceID >> (2 * d)) & 3];
+    }
+
+    gl_Position = MVP * vec4(BaseVertices[LeafCorner[gl_VertexID]] * s + offset, 1.0);
+    vColor = FaceColors[FaceColor[gl_VertexID / 3]];
+}
@@ -0,0 +1,371 @@
+// Geometry pipeline micro-benchmarks: no window and no GL context. Every GL call in the linked code
+// sits behind buffers these cases never create, so the glad function pointers are never loaded.
+//
+//   GeometryBench [--min-level 0] [--max-level 12] [--threads N] [--filter text] [--json results.json]
+//   GeometryBench --scaling 10 [--threads N] [--json results.json]
+//
+// --scaling replaces the level sweep: the pool generators at one level with 1, 2, 4 ... N threads,
+// with the speedup and parallel efficiency against one thread.
+//
+// Each case runs at least once and repeats until MinSeconds have passed; the fastest run is reported.
+// Allocation counts and peak heap bytes come from the first run, via the replaced operator new below.
+// The arena columns are the GeometryArena counters of the levels a case builds (GeometryArena.h): the
+// first run starts from an empty pool, later runs reuse the blocks it kept, and "heap blocks" counts
+// the blocks the last run still had to take from the heap.
+#include "../core/ThreadPool.h"
+#include "../rendering/GasketGeometry.h"
+#include "../rendering/GeometryArena.h"
+#include "../rendering/GeometryCache.h"
+#include "../rendering/LeafKernel.h"
+#include "../rendering/TetraGasket.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// --- Heap counters ---
+
+namespace {
+    std::atomic<size_t> Allocations{ 0 };
+    std::atomic<size_t> LiveBytes{ 0 };
+    std::atomic<size_t> PeakBytes{ 0 };
+
+    // the size is kept in front of every block; align bytes so the block itself stays aligned
+    void* allocate(size_t bytes, size_t align) {
+        size_t header = std::max(align, alignof(std::max_align_t));
+        void* raw = nullptr;
+        if (align > alignof(std::max_align_t)) {
+            size_t total = (bytes + header + align - 1) / align * align;
+            raw = std::aligned_alloc(align, total);
+        }
+        else {
+            raw = std::malloc(bytes + header);
+        }
+        if (!raw) throw std::bad_alloc();
+        *static_cast<size_t*>(raw) = bytes;
+
+        Allocations.fetch_add(1, std::memory_order_relaxed);
+        size_t live = LiveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = PeakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !PeakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+        return static_cast<char*>(raw) + header;
+    }
+
+    void release(void* block, size_t align) {
+        if (!block) return;
+        size_t header = std::max(align, alignof(std::max_align_t));
+        char* raw = static_cast<char*>(block) - header;
+        LiveBytes.fetch_sub(*reinterpret_cast<size_t*>(raw), std::memory_order_relaxed);
+        std::free(raw);
+    }
+}
+
+void* operator new(size_t bytes) { return allocate(bytes, 0); }
+void* operator new[](size_t bytes) { return allocate(bytes, 0); }
+void* operator new(size_t bytes, std::align_val_t align) { return allocate(bytes, size_t(align)); }
+void* operator new[](size_t bytes, std::align_val_t align) { return allocate(bytes, size_t(align)); }
+void operator delete(void* block) noexcept { release(block, 0); }
+void operator delete[](void* block) noexcept { release(block, 0); }
+void operator delete(void* block, size_t) noexcept { release(block, 0); }
+void operator delete[](void* block, size_t) noexcept { release(block, 0); }
+void operator delete(void* block, std::align_val_t align) noexcept { release(block, size_t(align)); }
+void operator delete[](void* block, std::align_val_t align) noexcept { release(block, size_t(align)); }
+void operator delete(void* block, size_t, std::align_val_t align) noexcept { release(block, size_t(align)); }
+void operator delete[](void* block, size_t, std::align_val_t align) noexcept { release(block, size_t(align)); }
+
+// --- Cases ---
+
+namespace {
+    constexpr double MinSeconds = 0.2;
+    constexpr int MaxRepetitions = 1000;
+
+    struct Result {
+        std::string Case;
+        int Level = 0;
+        size_t Tetras = 0;
+        int Repetitions = 0;
+        double Seconds = 0.0; // fastest run
+        size_t BytesEmitted = 0; // vertex, index or offset data the case produces
+        size_t Allocations = 0; // first run
+        size_t PeakBytes = 0; // first run, above what was live before it
+        size_t ArenaAllocations = 0; // first run
+        size_t ArenaHeapBlocks = 0; // last run, with the blocks kept by the runs before it
+        size_t ArenaPeakBytes = 0; // reserved by the arena pool, over all runs
+
+        double nsPerTetra() const { return Seconds * 1e9 / double(Tetras); }
+        double trianglesPerSecond() const { return 4.0 * double(Tetras) / Seconds; }
+        double gigabytesPerSecond() const { return double(BytesEmitted) / Seconds * 1e-9; }
+    };
+
+    // body() returns the bytes it emitted; setup() runs untimed before every repetition
+    Result measure(const std::string& name, int level, const std::function<void()>& setup,
+        const std::function<size_t()>& body) {
+        Result result;
+        result.Case = name;
+        result.Level = level;
+        result.Tetras = GasketGeometry::tetraCount(level);
+        result.Seconds = 1e30;
+
+        ArenaPool& arena = ArenaPool::shared();
+        arena.trim();
+        arena.resetPeak();
+
+        double total = 0.0;
+        while (result.Repetitions == 0 || (total < MinSeconds && result.Repetitions < MaxRepetitions)) {
+            setup();
+            size_t allocations = Allocations.load();
+            size_t live = LiveBytes.load();
+            PeakBytes.store(live);
+            ArenaStats arenaBefore = arena.stats();
+
+            auto start = std::chrono::steady_clock::now();
+            size_t bytes = body();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            ArenaStats arenaAfter = arena.stats();
+            result.ArenaHeapBlocks = arenaAfter.HeapBlocks - arenaBefore.HeapBlocks;
+
+            if (result.Repetitions == 0) {
+                result.BytesEmitted = bytes;
+                result.Allocations = Allocations.load() - allocations;
+                result.PeakBytes = PeakBytes.load() - live;
+                result.ArenaAllocations = arenaAfter.Allocations - arenaBefore.Allocations;
+            }
+            result.Seconds = std::min(result.Seconds, seconds);
+            total += seconds;
+            ++result.Repetitions;
+        }
+        result.ArenaPeakBytes = arena.stats().Peak;
+        return result;
+    }
+
+    struct Case {
+        std::string Name;
+        std::function<Result(int)> Run; // one level
+    };
+
+    // "Float32 (24 B)" -> "Float32"
+    std::string shortName(const char* name) {
+        return std::string(name, std::strcspn(name, " "));
+    }
+
+    size_t streamBytes(const GasketLevel& level) {
+        size_t total = 0;
+        for (int stream = 0; stream < GasketLevel::StreamCount; ++stream) {
+            const void* data;
+            size_t bytes;
+            level.streamData(stream, data, bytes);
+            total += bytes;
+        }
+        return total;
+    }
+
+    // TetraGasket's CPU build for one mode and format, with no disk cache and no parent level
+    void addBuildCases(std::vector<Case>& cases, ThreadPool& pool) {
+        struct Variant {
+            GasketMode Mode;
+            VertexFormat Format;
+        };
+        const Variant variants[] = {
+            { GasketMode::Triangles, VertexFormat::Float32 },
+            { GasketMode::Triangles, VertexFormat::Snorm16 },
+            { GasketMode::Triangles, VertexFormat::Lattice16 },
+            { GasketMode::Indexed, VertexFormat::Float32 },
+            { GasketMode::Instanced, VertexFormat::Float32 },
+        };
+        for (const Variant& variant : variants) {
+            std::string name = "TetraGasket::produceLevel/" + shortName(gasketModeName(variant.Mode));
+            if (variant.Mode != GasketMode::Instanced) name += "/" + shortName(vertexFormatName(variant.Format));
+            cases.push_back({ name, [=, &pool](int level) {
+                std::unique_ptr<GasketLevel> out;
+                return measure(name, level, [&]() { out.reset(); }, [&]() {
+                    out = std::make_unique<GasketLevel>();
+                    out->Mode = variant.Mode;
+                    out->Format = variant.Format;
+                    out->Level = level;
+                    TetraGasket::produceLevel(*out, nullptr, &pool, nullptr, "");
+                    return streamBytes(*out);
+                });
+            } });
+        }
+
+        // what Copy uploads hand to glNamedBufferSubData, copied into a staging block of the same size:
+        // the CPU side of the upload, without a driver
+        const char* upload = "upload copy/Triangles/Float32";
+        cases.push_back({ upload, [=, &pool](int level) {
+            GasketLevel built;
+            built.Level = level;
+            TetraGasket::produceLevel(built, nullptr, &pool, nullptr, "");
+            std::unique_ptr<uint8_t[]> staging(new uint8_t[std::max<size_t>(streamBytes(built), 1)]);
+            return measure(upload, level, []() {}, [&]() {
+                size_t offset = 0;
+                for (int stream = 0; stream < GasketLevel::StreamCount; ++stream) {
+                    const void* data;
+                    size_t bytes;
+                    built.streamData(stream, data, bytes);
+                    if (bytes) std::memcpy(staging.get() + offset, data, bytes);
+                    offset += bytes;
+                }
+                return offset;
+            });
+        } });
+    }
+
+    // generate/pool and a Triangles build at one level, on pools of 1, 2, 4 ... maxThreads threads
+    void runScaling(int level, unsigned maxThreads, std::vector<Result>& results) {
+        std::vector<unsigned> counts;
+        for (unsigned threads = 1; threads < maxThreads; threads *= 2) counts.push_back(threads);
+        counts.push_back(maxThreads);
+
+        std::printf("%-40s %5s %8s %12s %9s %11s\n", "case", "level", "threads", "ms", "speedup", "efficiency");
+        std::vector<glm::vec3> positions(GasketGeometry::vertexCount(level)), colors(positions.size());
+        for (const char* name : { "GasketGeometry::generate/pool", "TetraGasket::produceLevel/Triangles" }) {
+            bool generate = name[0] == 'G';
+            double single = 0.0;
+            for (unsigned threads : counts) {
+                ThreadPool pool(threads);
+                std::unique_ptr<GasketLevel> out;
+                std::string label = std::string(name) + "/x" + std::to_string(threads);
+                Result result = generate
+                    ? measure(label, level, []() {}, [&]() {
+                        GasketGeometry::generate(level, positions.data(), colors.data(), pool);
+                        return 2 * positions.size() * sizeof(glm::vec3);
+                    })
+                    : measure(label, level, [&]() { out.reset(); }, [&]() {
+                        out = std::make_unique<GasketLevel>();
+                        out->Level = level;
+                        TetraGasket::produceLevel(*out, nullptr, &pool, nullptr, "");
+                        return streamBytes(*out);
+                    });
+                if (threads == 1) single = result.Seconds;
+                double speedup = single / result.Seconds;
+                std::printf("%-40s %5d %8u %12.2f %8.2fx %10.0f%%\n", name, level, threads, result.Seconds * 1e3,
+                    speedup, 100.0 * speedup / threads);
+                std::fflush(stdout);
+                results.push_back(result);
+            }
+        }
+    }
+
+    void writeJson(const std::string& path, const std::vector<Result>& results, unsigned threads) {
+        std::ofstream file(path);
+        if (!file) throw std::runtime_error("Cannot write " + path);
+        char line[512];
+        file << "{\n";
+        file << "  \"benchmark\": \"GeometryBench\",\n";
+        file << "  \"threads\": " << threads << ",\n";
+        file << "  \"leaf_kernel\": \"" << LeafKernel::isaName(LeafKernel::detectIsa()) << "\",\n";
+        file << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            std::snprintf(line, sizeof(line),
+                "    { \"case\": \"%s\", \"level\": %d, \"tetras\": %zu, \"repetitions\": %d, \"seconds\": %.9g, "
+                "\"ns_per_tetra\": %.6g, \"triangles_per_second\": %.6g, \"bytes_emitted\": %zu, "
+                "\"gb_per_second\": %.6g, \"allocations\": %zu, \"peak_bytes\": %zu, \"arena_allocations\": %zu, "
+                "\"arena_heap_blocks\": %zu, \"arena_peak_bytes\": %zu }%s\n",
+                r.Case.c_str(), r.Level, r.Tetras, r.Repetitions, r.Seconds, r.nsPerTetra(), r.trianglesPerSecond(),
+                r.BytesEmitted, r.gigabytesPerSecond(), r.Allocations, r.PeakBytes, r.ArenaAllocations,
+                r.ArenaHeapBlocks, r.ArenaPeakBytes,
+                i + 1 < results.size() ? "," : "");
+            file << line;
+        }
+        file << "  ]\n}\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    int minLevel = 0;
+    int maxLevel = 12;
+    unsigned threads = std::thread::hardware_concurrency();
+    std::string filter;
+    std::string jsonPath;
+    int scalingLevel = -1;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i + 1 == argc) throw std::invalid_argument(arg + " needs a value");
+            std::string value = argv[++i];
+            if (arg == "--min-level") minLevel = std::stoi(value);
+            else if (arg == "--max-level") maxLevel = std::stoi(value);
+            else if (arg == "--threads") threads = static_cast<unsigned>(std::stoi(value));
+            else if (arg == "--filter") filter = value;
+            else if (arg == "--json") jsonPath = value;
+            else if (arg == "--scaling") scalingLevel = std::stoi(value);
+            else throw std::invalid_argument("Unknown option " + arg);
+        }
+        if (minLevel < 0 || maxLevel > GasketGeometry::MaxLevel || minLevel > maxLevel) {
+            throw std::invalid_argument("Levels must lie in 0.." + std::to_string(GasketGeometry::MaxLevel));
+        }
+
+        threads = std::max(threads, 1u);
+        if (scalingLevel >= 0) {
+            if (scalingLevel > GasketGeometry::MaxLevel) {
+                throw std::invalid_argument("Levels must lie in 0.." + std::to_string(GasketGeometry::MaxLevel));
+            }
+            std::printf("GeometryBench: scaling to %u threads, %s leaf kernel\n", threads,
+                LeafKernel::isaName(LeafKernel::detectIsa()));
+            std::vector<Result> results;
+            runScaling(scalingLevel, threads, results);
+            if (!jsonPath.empty()) writeJson(jsonPath, results, threads);
+            return EXIT_SUCCESS;
+        }
+
+        ThreadPool pool(threads);
+        std::vector<Case> cases;
+
+        // the recursive generator (dividePyramid), into preallocated output: one thread, then the pool
+        cases.push_back({ "GasketGeometry::generate", [](int level) {
+            std::vector<glm::vec3> positions(GasketGeometry::vertexCount(level)), colors(positions.size());
+            return measure("GasketGeometry::generate", level, []() {}, [&]() {
+                GasketGeometry::generate(level, positions.data(), colors.data());
+                return 2 * positions.size() * sizeof(glm::vec3);
+            });
+        } });
+        cases.push_back({ "GasketGeometry::generate/pool", [&pool](int level) {
+            std::vector<glm::vec3> positions(GasketGeometry::vertexCount(level)), colors(positions.size());
+            return measure("GasketGeometry::generate/pool", level, []() {}, [&]() {
+                GasketGeometry::generate(level, positions.data(), colors.data(), pool);
+                return 2 * positions.size() * sizeof(glm::vec3);
+            });
+        } });
+        addBuildCases(cases, pool);
+
+        std::printf("GeometryBench: %u threads, %s leaf kernel\n", pool.size(),
+            LeafKernel::isaName(LeafKernel::detectIsa()));
+        std::printf("%-52s %5s %10s %12s %9s %10s %12s %12s %11s %12s\n", "case", "level", "ns/tetra", "Mtris/s",
+            "GB/s", "allocs", "peak MB", "arena allocs", "heap blocks", "arena MB");
+
+        std::vector<Result> results;
+        for (const Case& benchmark : cases) {
+            if (!filter.empty() && benchmark.Name.find(filter) == std::string::npos) continue;
+            for (int level = minLevel; level <= maxLevel; ++level) {
+                Result result = benchmark.Run(level);
+                std::printf("%-52s %5d %10.2f %12.2f %9.2f %10zu %12.2f %12zu %11zu %12.2f\n", result.Case.c_str(),
+                    result.Level, result.nsPerTetra(), result.trianglesPerSecond() * 1e-6, result.gigabytesPerSecond(),
+                    result.Allocations, result.PeakBytes / 1048576.0, result.ArenaAllocations, result.ArenaHeapBlocks,
+                    result.ArenaPeakBytes / 1048576.0);
+                std::fflush(stdout);
+                results.push_back(result);
+            }
+        }
+
+        if (!jsonPath.empty()) writeJson(jsonPath, results, pool.size());
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -1,15 +1,41 @@
 #include "Application.h"
+#include "HeadlessContext.h"
+#include "Trace.h"
 #include "../gui/UIManager.h"
+#include "../rendering/ImageFile.h"
+#include "../rendering/OffscreenTarget.h"
+#include "../rendering/RayMarcher.h"
+#include "../rendering/RayTracer.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <string>
 
+namespace {
+    double percentile(std::vector<double> values, double p) {
+        if (values.empty()) return 0.0;
+        size_t i = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+        std::nth_element(values.begin(), values.begin() + i, values.end());
+        return values[i];
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
 // --- Application Public ---
 
 void Application::run() {
+    TRACE_THREAD("Main");
     try {
         init();
         mainLoop();
@@ -17,10 +43,132 @@ void Application::run() {
     }
     catch (const std::exception& e) {
         std::cerr << "An unrecoverable error occurred: " << e.what() << std::endl;
-        if (window) {
-            glfwDestroyWindow(window);
+        // still stops a running export and frees the GL objects before the window goes
+        cleanup();
+    }
+}
+
+void Application::renderImage(const std::string& path, int level, int width, int height, bool distanceEstimator) {
+    initCamera();
+    glm::mat4 projection = cam.getProjectionMatrix((float)width / (float)height);
+    glm::mat4 view = cam.getViewMatrix();
+
+    RgbImage image;
+    RayTracer::Stats stats;
+    if (distanceEstimator) {
+        RayMarcher::Settings settings;
+        settings.Iterations = level;
+        stats = RayMarcher::render(settings, view, projection, width, height, image, &pool);
+    }
+    else {
+        stats = RayTracer::render(level, view, projection, width, height, image, &pool);
+    }
+    ImageFile::write(path, image);
+    std::printf("%s level %d at %dx%d in %.1f ms (%.2f Mrays/s, %u threads%s%s) -> %s\n",
+        distanceEstimator ? "Ray marched" : "Ray traced", level, width, height, stats.Seconds * 1e3,
+        stats.megaRaysPerSecond(), pool.size(), distanceEstimator ? ", " : "",
+        distanceEstimator ? RayMarchKernel::isaName(LeafKernel::detectIsa()) : "", path.c_str());
+}
+
+void Application::runHeadless(const HeadlessSettings& settings) {
+    if (settings.Frames <= 0) {
+        throw std::invalid_argument("Headless mode needs at least one frame");
+    }
+
+    TRACE_THREAD("Main");
+    HeadlessContext context;
+    context.create();
+    OffscreenTarget target;
+
+    // every GL object goes before the context, also when a build, a frame or the report throws
+    struct Teardown {
+        Application& App;
+        OffscreenTarget& Target;
+        HeadlessContext& Context;
+        ~Teardown() {
+            App.gasket.cleanup();
+            App.shader.cleanup();
+            Target.release();
+            Context.destroy();
         }
-        glfwTerminate();
+    } teardown{ *this, target, context };
+
+    target.create(settings.Width, settings.Height, settings.Samples);
+    Mode = settings.Mode;
+    Format = settings.Format;
+    initScene();
+
+    std::printf("# %s, %s, %s\n", context.backend(), reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+        reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+    auto buildStart = std::chrono::steady_clock::now();
+    gasket.generate(settings.Level, &pool);
+    std::printf("# %s level %d, %s, %dx%d, %dx MSAA, built in %.1f ms\n", gasketModeName(Mode), settings.Level,
+        vertexFormatName(Format), target.width(), target.height(), std::max(target.samples(), 1),
+        millisecondsSince(buildStart));
+
+    // a GPU timestamp before and after each frame, read back after the last one
+    // (llvmpipe reports nonsense for the first GL_TIME_ELAPSED query, timestamps are fine)
+    std::vector<GLuint> queries(2 * size_t(settings.Frames));
+    glCreateQueries(GL_TIMESTAMP, 2 * settings.Frames, queries.data());
+    std::vector<double> cpuMs(settings.Frames), gpuMs(settings.Frames), frameMs(settings.Frames);
+
+    RgbImage image;
+    target.bind();
+    for (int frame = 0; frame < settings.Frames; ++frame) {
+        float angle = settings.OrbitDegrees * frame * 3.14159265f / 180.0f;
+        cam.setPosition(glm::vec3(2.0f * std::sin(angle), 0.0f, 2.0f * std::cos(angle)));
+
+        TRACE_ZONE("Frame");
+        auto frameStart = std::chrono::steady_clock::now();
+        glQueryCounter(queries[2 * frame], GL_TIMESTAMP);
+        gasket.update();
+        drawScene(target.width(), target.height());
+        glQueryCounter(queries[2 * frame + 1], GL_TIMESTAMP);
+        cpuMs[frame] = millisecondsSince(frameStart);
+        // frames do not overlap, so frame_ms is the whole cost of one, also where the driver defers the
+        // rasterization to the flush (llvmpipe) and the timestamps miss it
+        glFinish();
+        frameMs[frame] = millisecondsSince(frameStart);
+
+        bool last = frame == settings.Frames - 1;
+        if (settings.DumpPath.empty() || !(last || (settings.DumpEvery > 0 && frame % settings.DumpEvery == 0))) {
+            continue;
+        }
+        std::filesystem::path path = settings.DumpPath;
+        if (!last) {
+            path.replace_filename(path.stem().string() + "-" + std::to_string(frame) + path.extension().string());
+        }
+        target.read(image);
+        ImageFile::write(path.string(), image);
+    }
+
+    for (int frame = 0; frame < settings.Frames; ++frame) {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(queries[2 * frame], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(queries[2 * frame + 1], GL_QUERY_RESULT, &end);
+        gpuMs[frame] = (end - begin) * 1e-6;
+    }
+    glDeleteQueries(2 * settings.Frames, queries.data());
+
+    std::ofstream file;
+    if (!settings.ReportPath.empty()) {
+        file.open(settings.ReportPath);
+        if (!file) throw std::runtime_error("Cannot write " + settings.ReportPath);
+    }
+    std::ostream& report = settings.ReportPath.empty() ? std::cout : file;
+    report << "frame,cpu_ms,gpu_ms,frame_ms\n";
+    for (int frame = 0; frame < settings.Frames; ++frame) {
+        report << frame << ',' << cpuMs[frame] << ',' << gpuMs[frame] << ',' << frameMs[frame] << '\n';
+    }
+    report.flush();
+
+    std::printf("# median / p95 ms: cpu %.3f / %.3f, gpu %.3f / %.3f, frame %.3f / %.3f\n",
+        percentile(cpuMs, 0.5), percentile(cpuMs, 0.95), percentile(gpuMs, 0.5), percentile(gpuMs, 0.95),
+        percentile(frameMs, 0.5), percentile(frameMs, 0.95));
+
+    if (Trace::Enabled) {
+        saveTrace("gasket-headless.json");
     }
 }
 
@@ -54,14 +202,23 @@ void Application::init() {
         throw std::runtime_error("Failed to initialize GLAD");
     }
 
+    glViewport(0, 0, windowWidth, windowHeight);
+
+    gui.init(window);
+
+    initScene();
+
+    // init state
+    SubdivisionLevel = 0;
+    LevelChanged = true;
+}
+
+void Application::initScene() {
 	glEnable(GL_MULTISAMPLE);   // enable MSAA
 
-    glViewport(0, 0, windowWidth, windowHeight);
     glEnable(GL_DEPTH_TEST); // z-buffer
 	glEnable(GL_CULL_FACE);  // cull back-face
 
-    gui.init(window);
-
     try {
         shader.load("shader/gasket.vert", "shader/gasket.frag");
     }
@@ -69,70 +226,261 @@ void Application::init() {
         throw std::runtime_error(std::string("Shader load error: ") + e.what());
     }
 
-    gasket.init();
+    MvpLocation = shader.location("MVP");
+    if (MvpLocation == -1) {
+        std::cerr << "Warning: Uniform 'MVP' not found in shader." << std::endl;
+    }
+    gasket.init(shader);
+    gasket.setCacheBudget(GeometryCacheBudget);
+    ArenaPool::shared().setRetained(ArenaRetained);
+    gasket.setChunkBudget(ChunkBudget);
+    gasket.setDiskCache(MeshCacheDirectory);
+
+    // levels saved by an earlier run are mapped and uploaded, no geometry is rebuilt
+    gasket.setFractal(Shape);
+    gasket.setMode(Mode);
+    gasket.setVertexFormat(Format);
+    gasket.setUploadPath(Upload);
+    for (int level : PreloadLevels) {
+        gasket.preload(level, &pool);
+    }
+
+    initCamera();
+}
 
+void Application::initCamera() {
     // Z=2 -> (0,0,0)
     cam.setPosition(glm::vec3(0.0f, 0.0f, 2.0f));
     cam.setTarget(glm::vec3(0.0f, 0.0f, 0.0f));
+}
 
-    // init state
-    SubdivisionLevel = 0;
-    LevelChanged = true;
+void Application::updateCamera() {
+    double now = glfwGetTime();
+    float seconds = static_cast<float>(std::min(now - LastCameraTime, 0.1)); // no jump after a long frame
+    LastCameraTime = now;
+    if (gui.wantsKeyboard()) return;
+
+    auto held = [this](int key) { return glfwGetKey(window, key) == GLFW_PRESS ? 1.0f : 0.0f; };
+    float yaw = held(GLFW_KEY_RIGHT) - held(GLFW_KEY_LEFT);
+    float pitch = held(GLFW_KEY_UP) - held(GLFW_KEY_DOWN);
+    float zoom = held(GLFW_KEY_W) - held(GLFW_KEY_S);
+    if (held(GLFW_KEY_R) > 0.0f) {
+        OrbitYaw = OrbitPitch = 0.0f;
+        Zoom = 1.0f;
+    }
+    else if (yaw == 0.0f && pitch == 0.0f && zoom == 0.0f) {
+        return;
+    }
+    else {
+        const float radiansPerSecond = 1.5f;
+        const float maxPitch = 1.5f; // short of the poles, where lookAt loses its up vector
+        OrbitYaw += yaw * radiansPerSecond * seconds;
+        OrbitPitch = std::clamp(OrbitPitch + pitch * radiansPerSecond * seconds, -maxPitch, maxPitch);
+        Zoom = std::clamp(Zoom * std::exp(zoom * 2.0f * seconds), 1.0f, 4096.0f); // about 7x per second
+    }
+
+    // the meshlet, LOD and chunk culling see the new view matrices in drawScene()
+    cam.setPosition(2.0f * glm::vec3(std::cos(OrbitPitch) * std::sin(OrbitYaw), std::sin(OrbitPitch),
+        std::cos(OrbitPitch) * std::cos(OrbitYaw)));
+    cam.setZoom(Zoom);
 }
 
 void Application::mainLoop() {
     while (!glfwWindowShouldClose(window)) {
+        Stats.beginFrame();
+
 		// unput handling
         glfwPollEvents();
+        updateCamera();
+        Stats.lap(FrameStats::Poll);
 
         gui.beginFrame();
 
         // draw UI
         int previousLevel = SubdivisionLevel;
-        gui.drawContextMenu(SubdivisionLevel);
+        Fractal previousShape = Shape;
+        GasketMode previousMode = Mode;
+        VertexFormat previousFormat = Format;
+        gui.drawContextMenu(SubdivisionLevel, Shape, Mode, Format, Upload, LodPixelThreshold, ExportLevel, Export, ExportRequested, ShowPerformance);
+        if (ShowPerformance) {
+            drawPerformance();
+        }
+
+        // a mode or fractal switch may leave the level deeper than the new one can hold
+        bool levelIgnored = (Mode == GasketMode::Lod && Shape == Fractal::Tetrahedron);
+        if (SubdivisionLevel > fractalMaxLevel(Shape, Mode) && !levelIgnored) {
+            SubdivisionLevel = fractalMaxLevel(Shape, Mode);
+        }
 
-        // Level changed
-        if (SubdivisionLevel != previousLevel) {
+        // Level, fractal, geometry mode or vertex format changed
+        if (SubdivisionLevel != previousLevel || Shape != previousShape || Mode != previousMode || Format != previousFormat) {
             LevelChanged = true;
         }
+        Stats.lap(FrameStats::Ui);
 
         // Geometry update
         if (LevelChanged) {
-            gasket.generate(SubdivisionLevel);
+            gasket.setFractal(Shape);
+            gasket.setMode(Mode);
+            gasket.setVertexFormat(Format);
+            gasket.setUploadPath(Upload);
+            gasket.generateAsync(SubdivisionLevel, &pool);
             LevelChanged = false; // reset flag
         }
 
-        // Rendering
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        shader.use();
+        // finished background builds go to the GPU a slice per frame; the old level draws until then
+        gasket.update();
+        std::string buildError;
+        if (gasket.takeBuildError(buildError)) {
+            std::cerr << "Warning: level build failed: " << buildError << std::endl;
+            // back to what is drawn, so the menu shows the level on screen
+            if (const GasketLevel* shown = gasket.current()) {
+                SubdivisionLevel = shown->Level;
+                Shape = shown->Shape;
+                Mode = shown->Mode;
+                Format = shown->Format;
+            }
+            else {
+                SubdivisionLevel = 0;
+                LevelChanged = true;
+            }
+        }
+        if (const char* stage = gasket.buildStage()) {
+            gui.drawBuildStatus(stage, gasket.buildProgress());
+        }
 
-        // MVP
-        glm::mat4 projection = cam.getProjectionMatrix((float)windowWidth / (float)windowHeight);
-        glm::mat4 view = cam.getViewMatrix();
-        glm::mat4 model = glm::mat4(1.0f); // x}
+        if (ExportRequested) {
+            startExport();
+            ExportRequested = false;
+        }
+        updateExport();
+        if (TraceRequested) {
+            saveTrace("gasket-" + std::to_string(++TraceCount) + ".json");
+            TraceRequested = false;
+        }
+        if (ExportJob.valid() && !gasket.buildStage()) {
+            gui.drawBuildStatus("Exporting", ExportProgress.fraction());
+        }
 
-        shader.setMat4("MVP", projection * view * model);
+        Stats.lap(FrameStats::Generate);
 
-        // draw 3D gasket
-        gasket.draw();
+        // Rendering
+        Stats.beginGpuDraw();
+        drawScene(windowWidth, windowHeight);
+        Stats.endGpuDraw();
 
-        // draw ImGui
+        // draw ImGui: its GL commands are charged to Draw, UI is the time spent building the menus
         gui.endFrame();
+        Stats.endGpuFrame();
+        Stats.lap(FrameStats::Draw);
 
         glfwSwapBuffers(window);
+        Stats.lap(FrameStats::Swap);
+        Stats.endFrame();
+    }
+}
+
+void Application::drawScene(int width, int height) {
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    shader.use();
+
+    // MVP
+    glm::mat4 projection = cam.getProjectionMatrix((float)width / (float)height);
+    glm::mat4 view = cam.getViewMatrix();
+    glm::mat4 model = glm::mat4(1.0f); // x}
+
+    shader.setMat4(MvpLocation, projection * view * model);
+
+    // LOD mode re-selects its nodes when the view or threshold changes
+    gasket.setLodPixelThreshold(LodPixelThreshold);
+    gasket.updateView(view, projection, height);
+
+    // draw 3D gasket
+    gasket.draw(shader);
+}
+
+void Application::drawPerformance() {
+    UIManager::GeometryStats geometry;
+    geometry.Triangles = gasket.drawnTriangles();
+    if (const GasketLevel* level = gasket.current()) {
+        geometry.LevelGpuBytes = level->gpuBytes();
+        geometry.LevelCpuBytes = level->cpuBytes();
+    }
+    geometry.CacheBytes = gasket.cache().bytes();
+    geometry.CachedLevels = gasket.cache().size();
+    geometry.Arena = ArenaPool::shared().stats();
+    gui.drawPerformance(Stats, geometry);
+}
+
+void Application::saveTrace(const std::string& name) {
+    if (!Trace::Enabled) {
+        std::cerr << "Warning: tracing is compiled out, configure with -DGASKET_TRACE=ON" << std::endl;
+        return;
+    }
+    std::error_code error;
+    std::filesystem::create_directories("trace", error); // save() reports a directory it cannot write to
+    std::string path = (std::filesystem::path("trace") / name).string();
+    if (Trace::save(path)) {
+        std::cout << "Saved trace " << path << std::endl;
+    }
+}
+
+void Application::startExport() {
+    if (ExportJob.valid()) {
+        std::cerr << "Warning: an export is already running" << std::endl;
+        return;
+    }
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "gasket-L%02d.%s", ExportLevel, exportExtension(Export));
+    std::filesystem::create_directories("export");
+    ExportPath = (std::filesystem::path("export") / name).string();
+
+    ExportProgress.Done = 0;
+    ExportProgress.Cancelled = false;
+    ExportJob = std::async(std::launch::async, [this, path = ExportPath, format = Export, level = ExportLevel]() {
+        TRACE_THREAD("Export");
+        ThreadPool exportPool;
+        GasketExport::write(path, format, level, &exportPool, &ExportProgress);
+    });
+}
+
+void Application::updateExport() {
+    if (!ExportJob.valid() || ExportJob.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+
+    try {
+        ExportJob.get();
+        std::cout << "Exported " << ExportPath << std::endl;
+    }
+    catch (const BuildCancelled&) {
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Warning: export failed: " << e.what() << std::endl;
     }
 }
 
 void Application::cleanup()
 {
+    // an unfinished export stops at its next chunk and removes its file
+    if (ExportJob.valid()) {
+        ExportProgress.Cancelled = true;
+        ExportJob.wait();
+    }
+
+    if (Trace::Enabled) {
+        saveTrace("gasket-exit.json");
+    }
+
     gui.cleanup();
+    Stats.release();
     gasket.cleanup();
     shader.cleanup();
 
     if (window) {
         glfwDestroyWindow(window);
+        window = nullptr;
     }
     glfwTerminate();
 }
@@ -147,6 +495,11 @@ void Application::keyCallback(GLFWwindow* window, int key, int scancode, int act
     if ((key == GLFW_KEY_Q && action == GLFW_PRESS)) {
         glfwSetWindowShouldClose(window, true);
     }
+
+    // 't' or 'T' to save the trace recorded so far
+    if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+        app->TraceRequested = true;
+    }
 }
 
 void Application::framebufferSizeCallback(GLFWwindow* window, int width, int height)
@@ -2,19 +2,53 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <future>
+#include <string>
+#include <vector>
 #include "Camera.h"
+#include "FrameStats.h"
 #include "Shader.h"
+#include "ThreadPool.h"
+#include "../rendering/BuildProgress.h"
+#include "../rendering/GasketExport.h"
 #include "../rendering/TetraGasket.h"
 #include "../gui/UIManager.h"
 
+// --headless: renders frames with the interactive path into an offscreen framebuffer, no window
+struct HeadlessSettings {
+    int Level = 8;
+    int Frames = 100;
+    int Width = 1280;
+    int Height = 720;
+    int Samples = 16; // MSAA, like the window; clamped to what the driver offers
+    GasketMode Mode = GasketMode::Triangles;
+    VertexFormat Format = VertexFormat::Float32;
+    float OrbitDegrees = 0.0f; // camera turn per frame around the y axis, 0 = the startup view throughout
+    std::string ReportPath; // per-frame CSV, "" = standard output
+    std::string DumpPath; // image of the last frame (.png / .ppm), "" = none
+    int DumpEvery = 0; // also every N-th frame, as <name>-<frame>.<ext>
+};
+
 class Application {
 public:
     void run();
+    void runHeadless(const HeadlessSettings& settings);
+    // renders the startup view of the given level on the CPU, with no window or GL context:
+    // ray traced exactly, or ray marched through the distance estimator (level = fold iterations)
+    void renderImage(const std::string& path, int level, int width, int height, bool distanceEstimator = false);
 
 private:
     void init();
+    void initScene(); // GL state, shader and gasket; needs a current context
+    void initCamera();
+    void updateCamera(); // once per frame: arrows orbit, W / S zoom, R resets the view
     void mainLoop();
+    void drawScene(int width, int height); // clear, then the gasket from the current camera
+    void drawPerformance(); // the HUD, from the frames measured so far
+    void saveTrace(const std::string& name); // under trace/, when built with GASKET_TRACE
     void cleanup();
+    void startExport();
+    void updateExport(); // reports a finished export
 
     // static Callbacks
     static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -24,11 +58,37 @@ private:
     UIManager gui;
     Camera cam;
     Shader shader;
+    GLint MvpLocation = -1; // looked up once the shader is linked
     TetraGasket gasket;
+    ThreadPool pool; // one thread per core, used for geometry generation
+    FrameStats Stats; // CPU phases and GPU time of every frame, shown by the performance HUD
 
     // A
     int windowWidth = 1280;
     int windowHeight = 720;
     int SubdivisionLevel = 0; // l subdivision level = 0
+    Fractal Shape = Fractal::Tetrahedron;
+    GasketMode Mode = GasketMode::Triangles;
+    VertexFormat Format = VertexFormat::Float32;
+    UploadPath Upload = UploadPath::Copy;
+    float LodPixelThreshold = 1.0f;
+    size_t GeometryCacheBudget = size_t(512) << 20; // bytes of cached levels, CPU + GPU
+    size_t ChunkBudget = size_t(512) << 20; // GPU bytes for the chunks of a Chunked level
+    size_t ArenaRetained = ArenaPool::DefaultRetained; // freed level memory kept for the next builds
+    std::string MeshCacheDirectory = "cache"; // generated levels saved as .gmesh files, "" = off
+    std::vector<int> PreloadLevels; // built or read from disk at startup, e.g. { 8, 9, 10, 11 } with a larger budget
+    int ExportLevel = 8;
+    ExportFormat Export = ExportFormat::Stl;
+    bool ExportRequested = false;
+    bool ShowPerformance = false;
+    bool TraceRequested = false; // 'T' saves the recorded trace zones, see Trace.h
+    int TraceCount = 0;
+    std::string ExportPath;
+    std::future<void> ExportJob; // runs with its own thread pool, so it never waits on a geometry build
+    BuildProgress ExportProgress;
+    float OrbitYaw = 0.0f; // radians around the y axis, 0 = looking down -z as at startup
+    float OrbitPitch = 0.0f;
+    float Zoom = 1.0f;
+    double LastCameraTime = 0.0; // glfwGetTime() of the previous updateCamera()
     bool LevelChanged = true; // аO level O_ܡAHKs
 };
\ No newline at end of file
@@ -7,7 +7,8 @@ Camera::Camera()
     Fov(45.0f),                    // w] 45 ׵
     Near(0.1f),
     Far(100.0f),
-    OrthoSize(0.6f)
+    OrthoSize(0.6f),
+    Zoom(1.0f)
 {
 }
 
@@ -19,12 +20,16 @@ void Camera::setTarget(const glm::vec3& target) {
     Target = target;
 }
 
+void Camera::setZoom(float zoom) {
+    Zoom = zoom;
+}
+
 glm::mat4 Camera::getViewMatrix() const {
     return glm::lookAt(Position, Target, Up);
 }
 
 glm::mat4 Camera::getProjectionMatrix(float aspectRatio) const {
-    float top = OrthoSize;
+    float top = OrthoSize / Zoom;
     float bottom = -OrthoSize;
     float right = OrthoSize * aspectRatio;
     float left = -right;
@@ -10,6 +10,7 @@ public:
     // ]wvmM¦V
     void setPosition(const glm::vec3& pos);
     void setTarget(const glm::vec3& target);
+    void setZoom(float zoom); // magnification of the orthographic view, 1 = the startup view
 
     // o View M Projection x}
     glm::mat4 getViewMatrix() const;
@@ -21,6 +22,7 @@ private:
     glm::vec3 Target;
     glm::vec3 Up; // ڭ̰]ûO (0, 1, 0)
     float OrthoSize;
+    float Zoom;
 
     // vѼ
     float Fov;  //  (Field of View)
@@ -0,0 +1,120 @@
+#include "FrameStats.h"
+#include "Trace.h"
+
+#include <algorithm>
+
+void FrameStats::Series::push(float value) {
+    Values[Next] = value;
+    Next = (Next + 1) % History;
+    if (Count < History) ++Count;
+    SortedValid = false;
+}
+
+float FrameStats::Series::latest() const {
+    return Count ? Values[(Next + History - 1) % History] : 0.0f;
+}
+
+float FrameStats::Series::percentile(float p) const {
+    if (Count == 0) return 0.0f;
+    if (!SortedValid) {
+        // before the window fills, the values are at the front
+        std::copy(Values, Values + Count, Sorted);
+        std::sort(Sorted, Sorted + Count);
+        SortedValid = true;
+    }
+    size_t i = std::min(static_cast<size_t>(p * Count), static_cast<size_t>(Count - 1));
+    return Sorted[i];
+}
+
+const char* FrameStats::phaseName(Phase phase) {
+    switch (phase) {
+    case Poll: return "Poll";
+    case Ui: return "UI";
+    case Generate: return "Generate";
+    case Draw: return "Draw";
+    case Swap: return "Swap";
+    default: return "?";
+    }
+}
+
+void FrameStats::beginFrame() {
+    FrameStart = LastLap = Clock::now();
+    std::fill(std::begin(PhaseMs), std::end(PhaseMs), 0.0);
+
+    Slot& slot = Slots[Frame % Latency];
+    if (slot.Pending) collect();
+    Measuring = !slot.Pending;
+    if (!Measuring) return;
+
+    if (slot.Begin == 0) {
+        glCreateQueries(GL_TIMESTAMP, 1, &slot.Begin);
+        glCreateQueries(GL_TIMESTAMP, 1, &slot.End);
+        glCreateQueries(GL_TIME_ELAPSED, 1, &slot.Draw);
+    }
+    glQueryCounter(slot.Begin, GL_TIMESTAMP);
+}
+
+void FrameStats::lap(Phase phase) {
+    Clock::time_point now = Clock::now();
+    PhaseMs[phase] += std::chrono::duration<double, std::milli>(now - LastLap).count();
+    Trace::record(phaseName(phase), LastLap, now);
+    LastLap = now;
+}
+
+void FrameStats::beginGpuDraw() {
+    if (Measuring) glBeginQuery(GL_TIME_ELAPSED, Slots[Frame % Latency].Draw);
+}
+
+void FrameStats::endGpuDraw() {
+    if (Measuring) glEndQuery(GL_TIME_ELAPSED);
+}
+
+void FrameStats::endGpuFrame() {
+    if (!Measuring) return;
+    Slot& slot = Slots[Frame % Latency];
+    glQueryCounter(slot.End, GL_TIMESTAMP);
+    slot.Pending = true;
+}
+
+void FrameStats::endFrame() {
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        Phases[phase].push(static_cast<float>(PhaseMs[phase]));
+    }
+    Clock::time_point now = Clock::now();
+    CpuFrame.push(std::chrono::duration<float, std::milli>(now - FrameStart).count());
+    Trace::record("Frame", FrameStart, now);
+
+    ++Frame;
+    collect();
+}
+
+void FrameStats::collect() {
+    // slots finish in the order they were issued, so the oldest pending one comes first
+    for (int i = 0; i < Latency; ++i) {
+        Slot& slot = Slots[(Frame + i) % Latency];
+        if (!slot.Pending) continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(slot.End, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+
+        GLuint64 begin = 0, end = 0, draw = 0;
+        glGetQueryObjectui64v(slot.Begin, GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(slot.End, GL_QUERY_RESULT, &end);
+        glGetQueryObjectui64v(slot.Draw, GL_QUERY_RESULT, &draw);
+        GpuFrame.push(static_cast<float>((end - begin) * 1e-6));
+        GpuDraw.push(static_cast<float>(draw * 1e-6));
+        slot.Pending = false;
+    }
+}
+
+void FrameStats::release() {
+    for (Slot& slot : Slots) {
+        if (slot.Begin != 0) {
+            glDeleteQueries(1, &slot.Begin);
+            glDeleteQueries(1, &slot.End);
+            glDeleteQueries(1, &slot.Draw);
+        }
+        slot = Slot();
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <chrono>
+
+// Where the time of each frame goes: CPU phases timed on the main thread, and GPU time from timer
+// queries (GL_TIMESTAMP around the frame, GL_TIME_ELAPSED around the scene). The queries rotate
+// through Latency slots and are only read once GL reports them available, so reading them never
+// stalls; a frame whose slot is still in flight simply goes unmeasured on the GPU side.
+// Needs the GL context.
+class FrameStats {
+public:
+    enum Phase { Poll, Ui, Generate, Draw, Swap, PhaseCount };
+
+    static constexpr int History = 240; // frames kept for the plots and percentiles
+    static constexpr int Latency = 4;   // frames a query may stay in flight before its slot is needed again
+
+    // rolling window of one measurement, in milliseconds
+    struct Series {
+        float Values[History] = {};
+        int Next = 0; // where the next value goes; the oldest one once the window is full
+        int Count = 0;
+
+        void push(float value);
+        float latest() const;
+        float percentile(float p) const; // p in 0..1, 0 when empty
+        int plotOffset() const { return Count == History ? Next : 0; } // oldest value first
+
+    private:
+        // Values sorted on the first percentile() after a push, shared by the HUD's p50/p95/p99 and plot scale
+        mutable float Sorted[History] = {};
+        mutable bool SortedValid = false;
+    };
+
+    static const char* phaseName(Phase phase);
+
+    void beginFrame();
+    void lap(Phase phase); // charges the time since the previous lap (or beginFrame) to phase
+    void beginGpuDraw();
+    void endGpuDraw();
+    void endGpuFrame(); // after the last GL command of the frame, before the swap
+    void endFrame();    // after the swap
+    void release();
+
+    const Series& cpu(Phase phase) const { return Phases[phase]; }
+    const Series& cpuFrame() const { return CpuFrame; }
+    const Series& gpuFrame() const { return GpuFrame; }
+    const Series& gpuDraw() const { return GpuDraw; }
+
+private:
+    struct Slot {
+        GLuint Begin = 0; // GL_TIMESTAMP
+        GLuint End = 0;   // GL_TIMESTAMP
+        GLuint Draw = 0;  // GL_TIME_ELAPSED
+        bool Pending = false;
+    };
+
+    void collect(); // reads every finished slot, oldest first
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point FrameStart;
+    Clock::time_point LastLap;
+    double PhaseMs[PhaseCount] = {};
+
+    Slot Slots[Latency];
+    int Frame = 0; // frames begun, modulo Latency picks the slot
+    bool Measuring = false; // this frame's slot was free
+
+    Series Phases[PhaseCount];
+    Series CpuFrame;
+    Series GpuFrame;
+    Series GpuDraw;
+};
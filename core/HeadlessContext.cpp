@@ -0,0 +1,128 @@
+#include "HeadlessContext.h"
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#ifdef GASKET_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+#ifdef GASKET_HEADLESS_EGL
+
+namespace {
+    std::string eglError(const char* what) {
+        char code[16];
+        std::snprintf(code, sizeof(code), "0x%04X", static_cast<unsigned>(eglGetError()));
+        return std::string(what) + " (EGL error " + code + ")";
+    }
+
+    // Mesa's surfaceless platform needs neither X11 nor Wayland nor a GPU device node
+    EGLDisplay openDisplay() {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        EGLint major = 0, minor = 0;
+        if (getPlatformDisplay) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY && eglInitialize(display, &major, &minor)) return display;
+        }
+        EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+            throw std::runtime_error(eglError("Failed to initialize an EGL display"));
+        }
+        return display;
+    }
+}
+
+void HeadlessContext::create() {
+    Display = openDisplay();
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        destroy();
+        throw std::runtime_error(eglError("EGL has no desktop OpenGL"));
+    }
+
+    // a pbuffer config when there is one; surfaceless displays may offer none
+    const EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    eglChooseConfig(Display, configAttributes, &config, 1, &configCount);
+
+    const EGLint contextAttributes[] = { EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+    Context = eglCreateContext(Display, configCount > 0 ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT,
+        contextAttributes);
+    if (Context == EGL_NO_CONTEXT) {
+        destroy();
+        throw std::runtime_error(eglError("Failed to create an OpenGL 4.5 core EGL context"));
+    }
+
+    if (configCount > 0) {
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        Surface = eglCreatePbufferSurface(Display, config, surfaceAttributes);
+        if (Surface == EGL_NO_SURFACE) Surface = nullptr;
+    }
+    EGLSurface surface = Surface ? Surface : EGL_NO_SURFACE;
+    if (!eglMakeCurrent(Display, surface, surface, Context)) {
+        destroy();
+        throw std::runtime_error(eglError("Failed to make the EGL context current"));
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        destroy();
+        throw std::runtime_error("Failed to initialize GLAD");
+    }
+}
+
+void HeadlessContext::destroy() {
+    if (!Display) return;
+    eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (Surface) eglDestroySurface(Display, Surface);
+    if (Context) eglDestroyContext(Display, Context);
+    eglTerminate(Display);
+    Display = Context = Surface = nullptr;
+}
+
+const char* HeadlessContext::backend() const {
+    return Surface ? "EGL pbuffer" : "EGL surfaceless";
+}
+
+#else
+
+void HeadlessContext::create() {
+    if (!glfwInit()) {
+        throw std::runtime_error("Failed to initialize GLFW");
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    Window = glfwCreateWindow(1, 1, "headless", NULL, NULL);
+    if (!Window) {
+        glfwTerminate();
+        throw std::runtime_error("Failed to create a hidden GLFW window");
+    }
+    glfwMakeContextCurrent(Window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        destroy();
+        throw std::runtime_error("Failed to initialize GLAD");
+    }
+}
+
+void HeadlessContext::destroy() {
+    if (!Window) return;
+    glfwDestroyWindow(Window);
+    glfwTerminate();
+    Window = nullptr;
+}
+
+const char* HeadlessContext::backend() const {
+    return "GLFW hidden window";
+}
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glad/glad.h>
+
+struct GLFWwindow;
+
+// An OpenGL 4.5 core context with no visible window, for rendering into framebuffer objects.
+// Built with GASKET_HEADLESS_EGL it is an EGL context (surfaceless where Mesa offers it,
+// otherwise on a 1x1 pbuffer), which needs no display server; without it, a hidden GLFW window.
+// Throws when no such context can be created.
+class HeadlessContext {
+public:
+    void create(); // makes the context current and loads the GL functions
+    void destroy();
+    const char* backend() const; // "EGL surfaceless", "EGL pbuffer" or "GLFW hidden window"
+
+private:
+#ifdef GASKET_HEADLESS_EGL
+    void* Display = nullptr; // EGLDisplay
+    void* Context = nullptr; // EGLContext
+    void* Surface = nullptr; // EGLSurface, null when surfaceless
+#else
+    GLFWwindow* Window = nullptr;
+#endif
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile).
+// Pages are read in by the OS on first touch, so opening costs nothing per byte.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false if the file is missing, empty or cannot be mapped
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return Data != nullptr; }
+    const uint8_t* data() const { return Data; }
+    size_t size() const { return Size; }
+
+private:
+    const uint8_t* Data = nullptr;
+    size_t Size = 0;
+#ifdef _WIN32
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+#else
+    int Descriptor = -1;
+#endif
+};
@@ -1,4 +1,5 @@
 #include "Shader.h"
+#include "Trace.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -7,6 +8,7 @@
 
 void Shader::load(const char* vertexPath, const char* fragmentPath)
 {
+    TRACE_ZONE("Shader::load");
     // read GLSL code
     std::string vertexCode;
     std::string fragmentCode;
@@ -90,6 +92,10 @@ void Shader::setFloat(const std::string& name, float value) const {
     glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
 }
 
+void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
+    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+}
+
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
     // X uniform 'name' m
     GLint loc = glGetUniformLocation(ID, name.c_str());
@@ -101,6 +107,22 @@ void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
     glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(mat));
 }
 
+GLint Shader::location(const char* name) const {
+    return glGetUniformLocation(ID, name);
+}
+
+void Shader::setInt(GLint location, int value) const {
+    glUniform1i(location, value);
+}
+
+void Shader::setFloat(GLint location, float value) const {
+    glUniform1f(location, value);
+}
+
+void Shader::setMat4(GLint location, const glm::mat4& mat) const {
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
 void Shader::checkCompileErrors(GLuint shader, std::string type) {
     GLint success;
     GLchar infoLog[1024];
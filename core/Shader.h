@@ -19,8 +19,16 @@ public:
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
     void setFloat(const std::string& name, float value) const;
+    void setVec3(const std::string& name, const glm::vec3& value) const;
     void setMat4(const std::string& name, const glm::mat4& mat) const;
 
+    // Per-frame uniforms: look the location up once after load(), then set it through it,
+    // with no string building or glGetUniformLocation in the frame. -1 is ignored by GL.
+    GLint location(const char* name) const;
+    void setInt(GLint location, int value) const;
+    void setFloat(GLint location, float value) const;
+    void setMat4(GLint location, const glm::mat4& mat) const;
+
 private:
     void checkCompileErrors(GLuint shader, std::string type);
 };
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#include <string>
+
+// pool and queue index of the current worker thread (CurrentPool is null outside any pool)
+static thread_local const ThreadPool* CurrentPool = nullptr;
+static thread_local unsigned CurrentIndex = 0;
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) threadCount = 1;
+
+    unsigned workerCount = threadCount - 1;
+    for (unsigned i = 0; i <= workerCount; ++i) {
+        Queues.push_back(std::make_unique<Queue>());
+    }
+    Workers.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; ++i) {
+        Workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(StateMutex);
+        Stopping = true;
+    }
+    WakeCv.notify_all();
+    for (std::thread& worker : Workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task, Batch& batch) {
+    // workers push onto their own deque, everyone else spreads round-robin
+    unsigned index = (CurrentPool == this)
+        ? CurrentIndex
+        : NextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<unsigned>(Queues.size());
+
+    {
+        // counted together with the push, so a pop can never run ahead of the counters
+        Queue& queue = *Queues[index];
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        queue.Tasks.push_back({ std::move(task), &batch });
+        batch.Pending.fetch_add(1);
+        batch.Queued.fetch_add(1);
+        Queued.fetch_add(1);
+    }
+
+    // take the state lock so a worker or waiter about to sleep cannot miss this task
+    { std::lock_guard<std::mutex> lock(StateMutex); }
+    WakeCv.notify_one();
+    DoneCv.notify_all();
+}
+
+bool ThreadPool::popTask(unsigned index, Task& task, const Batch* only) {
+    auto take = [&](std::deque<Task>& tasks, std::deque<Task>::iterator at) {
+        task = std::move(*at);
+        tasks.erase(at);
+        task.Owner->Queued.fetch_sub(1);
+        Queued.fetch_sub(1);
+    };
+
+    // own work first (LIFO keeps it cache-warm)
+    {
+        Queue& own = *Queues[index];
+        std::lock_guard<std::mutex> lock(own.Mutex);
+        for (auto at = own.Tasks.end(); at != own.Tasks.begin();) {
+            --at;
+            if (!only || at->Owner == only) {
+                take(own.Tasks, at);
+                return true;
+            }
+        }
+    }
+
+    // then steal the oldest task of someone else
+    size_t count = Queues.size();
+    for (size_t i = 1; i < count; ++i) {
+        Queue& victim = *Queues[(index + i) % count];
+        std::lock_guard<std::mutex> lock(victim.Mutex);
+        for (auto at = victim.Tasks.begin(); at != victim.Tasks.end(); ++at) {
+            if (!only || at->Owner == only) {
+                take(victim.Tasks, at);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ThreadPool::runTask(Task& task) {
+    Batch& batch = *task.Owner;
+    try {
+        task.Run();
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(StateMutex);
+        if (!batch.Error) batch.Error = std::current_exception();
+    }
+    task = Task();
+
+    if (batch.Pending.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(StateMutex);
+        DoneCv.notify_all();
+    }
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    CurrentPool = this;
+    CurrentIndex = index;
+    TRACE_THREAD("Pool worker " + std::to_string(index + 1));
+
+    Task task;
+    while (true) {
+        if (popTask(index, task)) {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(StateMutex);
+        WakeCv.wait(lock, [this] { return Stopping || Queued.load() > 0; });
+        if (Stopping && Queued.load() == 0) return;
+    }
+}
+
+void ThreadPool::wait(Batch& batch) {
+    // the caller works off the shared queue slot (or its own, if it is a worker)
+    unsigned index = (CurrentPool == this) ? CurrentIndex : static_cast<unsigned>(Workers.size());
+
+    Task task;
+    while (batch.Pending.load() > 0) {
+        if (popTask(index, task, &batch)) {
+            runTask(task);
+            continue;
+        }
+
+        // nothing of this batch left to take: sleep until its running tasks are done or spawn more
+        std::unique_lock<std::mutex> lock(StateMutex);
+        DoneCv.wait(lock, [&batch] { return batch.Pending.load() == 0 || batch.Queued.load() > 0; });
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(StateMutex);
+        std::swap(error, batch.Error);
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    Batch batch;
+    for (size_t i = 0; i < count; ++i) {
+        submit([&body, i] { body(i); }, batch);
+    }
+    wait(batch);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool.
+// Each worker owns a deque: it pops its own work from the back and steals from the front of the others.
+// The thread calling wait() joins in, so a pool of N threads spawns N - 1 workers.
+// Tasks belong to a Batch, and wait() only waits for its own batch, so several threads (a level build
+// and the GL thread's chunk or meshlet work) can share the pool without waiting on each other's tasks.
+class ThreadPool {
+public:
+    // tasks waited for together; outlives them, one wait() at a time
+    class Batch {
+    public:
+        Batch() = default;
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+
+    private:
+        friend class ThreadPool;
+        std::atomic<size_t> Pending{ 0 }; // submitted but not finished
+        std::atomic<size_t> Queued{ 0 }; // sitting in a deque
+        std::exception_ptr Error; // first one thrown, under StateMutex
+    };
+
+    explicit ThreadPool(unsigned threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // number of threads taking part in wait(), including the caller
+    unsigned size() const { return static_cast<unsigned>(Workers.size()) + 1; }
+
+    void submit(std::function<void()> task, Batch& batch);
+
+    // run the batch's tasks on the calling thread until all of them have finished;
+    // rethrows the first exception thrown by one. Not to be called from inside a task.
+    void wait(Batch& batch);
+
+    // body(i) for i in [0, count) as one batch, then wait() for it
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    struct Task {
+        std::function<void()> Run;
+        Batch* Owner = nullptr;
+    };
+
+    struct Queue {
+        std::mutex Mutex;
+        std::deque<Task> Tasks;
+    };
+
+    // only: take nothing but that batch's tasks (a waiting caller must not pick up another's long task)
+    bool popTask(unsigned index, Task& task, const Batch* only = nullptr);
+    void runTask(Task& task);
+    void workerLoop(unsigned index);
+
+    std::vector<std::unique_ptr<Queue>> Queues; // one per worker + one for outside threads
+    std::vector<std::thread> Workers;
+
+    std::atomic<size_t> Queued{ 0 }; // tasks sitting in a deque, of every batch
+    std::atomic<unsigned> NextQueue{ 0 };
+
+    std::mutex StateMutex;
+    std::condition_variable WakeCv;
+    std::condition_variable DoneCv;
+    bool Stopping = false;
+};
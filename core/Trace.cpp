@@ -0,0 +1,176 @@
+#include "Trace.h"
+
+#ifdef GASKET_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+
+namespace {
+    // fields are relaxed atomics, so save() may read a slot while its thread rewrites it
+    struct Event {
+        std::atomic<const char*> Name{ nullptr };
+        std::atomic<int64_t> Begin{ 0 }; // ns since the epoch
+        std::atomic<int64_t> Duration{ 0 };
+        std::atomic<uint32_t> Thread{ 0 };
+    };
+
+    // Event i lives in slot i % EventsPerThread. Claimed runs ahead of Written while a slot is being
+    // filled, like a seqlock: a reader drops whatever Claimed shows may have been overwritten meanwhile.
+    struct Ring {
+        std::unique_ptr<Event[]> Events{ new Event[EventsPerThread] };
+        std::atomic<uint64_t> Claimed{ 0 };
+        std::atomic<uint64_t> Written{ 0 };
+    };
+
+    struct Registry {
+        std::mutex Mutex; // adding rings and naming threads; never taken by record()
+        std::vector<std::unique_ptr<Ring>> Rings; // kept after their thread exits, for save()
+        std::vector<Ring*> Free; // rings of exited threads, handed to the next new thread
+        std::map<uint32_t, std::string> ThreadNames;
+        uint32_t Threads = 0;
+        Clock::time_point Epoch = Clock::now();
+    };
+
+    Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    // the calling thread's ring; short-lived threads (builds, exports) reuse the rings of finished ones,
+    // so events carry their thread instead of the ring
+    struct ThreadRing {
+        Ring* Owned = nullptr;
+        uint32_t Thread = 0;
+
+        ThreadRing() {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.Mutex);
+            Thread = ++r.Threads;
+            if (!r.Free.empty()) {
+                Owned = r.Free.back();
+                r.Free.pop_back();
+            }
+            else {
+                r.Rings.push_back(std::make_unique<Ring>());
+                Owned = r.Rings.back().get();
+            }
+        }
+
+        ~ThreadRing() {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.Mutex);
+            r.Free.push_back(Owned);
+        }
+    };
+
+    ThreadRing& threadRing() {
+        thread_local ThreadRing ring;
+        return ring;
+    }
+
+    struct Copied {
+        const char* Name;
+        int64_t Begin;
+        int64_t Duration;
+        uint32_t Thread;
+    };
+
+    void writeEscaped(std::FILE* file, const char* text) {
+        for (; *text; ++text) {
+            if (*text == '"' || *text == '\\') std::fputc('\\', file);
+            std::fputc(*text, file);
+        }
+    }
+}
+
+void record(const char* name, Clock::time_point begin, Clock::time_point end) {
+    ThreadRing& mine = threadRing();
+    Ring& ring = *mine.Owned;
+    uint64_t i = ring.Written.load(std::memory_order_relaxed);
+    ring.Claimed.store(i + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Event& event = ring.Events[i % EventsPerThread];
+    event.Name.store(name, std::memory_order_relaxed);
+    event.Begin.store(std::chrono::duration_cast<std::chrono::nanoseconds>(begin - registry().Epoch).count(),
+        std::memory_order_relaxed);
+    event.Duration.store(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(),
+        std::memory_order_relaxed);
+    event.Thread.store(mine.Thread, std::memory_order_relaxed);
+    ring.Written.store(i + 1, std::memory_order_release);
+}
+
+void nameThread(const std::string& name) {
+    uint32_t thread = threadRing().Thread;
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.Mutex);
+    r.ThreadNames[thread] = name;
+}
+
+bool save(const std::string& path) {
+    std::vector<Copied> events;
+    std::map<uint32_t, std::string> names;
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.Mutex);
+        names = r.ThreadNames;
+        for (const std::unique_ptr<Ring>& ring : r.Rings) {
+            uint64_t end = ring->Written.load(std::memory_order_acquire);
+            uint64_t begin = end > EventsPerThread ? end - EventsPerThread : 0;
+            size_t first = events.size();
+            for (uint64_t i = begin; i < end; ++i) {
+                const Event& event = ring->Events[i % EventsPerThread];
+                events.push_back({ event.Name.load(std::memory_order_relaxed), event.Begin.load(std::memory_order_relaxed),
+                    event.Duration.load(std::memory_order_relaxed), event.Thread.load(std::memory_order_relaxed) });
+            }
+
+            // events the writer may have lapped while they were copied are dropped
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t claimed = ring->Claimed.load(std::memory_order_relaxed);
+            uint64_t valid = claimed > EventsPerThread ? claimed - EventsPerThread : 0;
+            if (valid > begin) {
+                size_t torn = static_cast<size_t>(std::min(valid, end) - begin);
+                events.erase(events.begin() + first, events.begin() + first + torn);
+            }
+        }
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        std::cerr << "Warning: cannot write trace " << path << std::endl;
+        return false;
+    }
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto& name : names) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+            first ? "" : ",\n", name.first);
+        writeEscaped(file, name.second.c_str());
+        std::fprintf(file, "\"}}");
+        first = false;
+    }
+    for (const Copied& event : events) {
+        std::fprintf(file, "%s{\"name\":\"", first ? "" : ",\n");
+        writeEscaped(file, event.Name);
+        std::fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.Thread,
+            event.Begin * 1e-3, event.Duration * 1e-3);
+        first = false;
+    }
+    std::fprintf(file, "\n]}\n");
+    bool written = std::fclose(file) == 0;
+    if (!written) std::cerr << "Warning: cannot write trace " << path << std::endl;
+    return written;
+}
+
+}
+
+#endif
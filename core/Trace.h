@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Scoped timing zones, saved as Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+// Built with GASKET_TRACE, each thread records into its own ring of events. Only that thread
+// writes to the ring, and save() reads it without locks. Once a ring is full its oldest events
+// are overwritten. Without GASKET_TRACE the macros expand to nothing and save() does nothing.
+//
+//   TRACE_ZONE("TetraGasket::produceLevel"); // from here to the end of the scope
+//   TRACE_THREAD("Level build");             // names the calling thread in the timeline
+namespace Trace {
+    using Clock = std::chrono::steady_clock;
+
+#ifdef GASKET_TRACE
+    constexpr bool Enabled = true;
+    constexpr size_t EventsPerThread = size_t(1) << 15;
+
+    // name is kept as a pointer: a string literal
+    void record(const char* name, Clock::time_point begin, Clock::time_point end);
+    void nameThread(const std::string& name);
+
+    // everything still in the rings; false (with a warning) when the file cannot be written
+    bool save(const std::string& path);
+
+    class Zone {
+    public:
+        explicit Zone(const char* name) : Name(name), Begin(Clock::now()) {}
+        ~Zone() { record(Name, Begin, Clock::now()); }
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char* Name;
+        Clock::time_point Begin;
+    };
+#else
+    constexpr bool Enabled = false;
+
+    inline void record(const char*, Clock::time_point, Clock::time_point) {}
+    inline bool save(const std::string&) { return false; }
+#endif
+}
+
+#ifdef GASKET_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) ::Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_THREAD(name) ::Trace::nameThread(name)
+#else
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+#endif
@@ -3,6 +3,8 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
+#include <algorithm>
+
 void UIManager::init(GLFWwindow* window) {
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -27,7 +29,8 @@ void UIManager::endFrame() {
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
-void UIManager::drawContextMenu(int& subdivisionLevel) {
+void UIManager::drawContextMenu(int& subdivisionLevel, Fractal& shape, GasketMode& mode, VertexFormat& format, UploadPath& upload, float& lodPixels,
+    int& exportLevel, ExportFormat& exportFormat, bool& exportRequested, bool& showPerformance) {
 
     ImGuiIO& io = ImGui::GetIO();
     ImGui::SetNextWindowPos(ImVec2(0.0f, 0.0f));
@@ -55,12 +58,86 @@ void UIManager::drawContextMenu(int& subdivisionLevel) {
             if (ImGui::MenuItem("1", NULL, subdivisionLevel == 1)) { subdivisionLevel = 1; }
             if (ImGui::MenuItem("2", NULL, subdivisionLevel == 2)) { subdivisionLevel = 2; }
             if (ImGui::MenuItem("3", NULL, subdivisionLevel == 3)) { subdivisionLevel = 3; }
+            ImGui::SliderInt("Deeper", &subdivisionLevel, 0, fractalMaxLevel(shape, mode));
+
+            ImGui::EndMenu();
+        }
+
+        // Item - Subdivision rule; everything but the tetrahedron is drawn as Triangles
+        if (ImGui::BeginMenu("Fractal"))
+        {
+            for (int i = 0; i < static_cast<int>(Fractal::Count); ++i) {
+                Fractal item = static_cast<Fractal>(i);
+                if (ImGui::MenuItem(fractalName(item), NULL, shape == item)) { shape = item; }
+            }
+
+            ImGui::EndMenu();
+        }
+
+        // Item - Geometry storage / draw path
+        if (ImGui::BeginMenu("Geometry"))
+        {
+            for (int i = 0; i < static_cast<int>(GasketMode::Count); ++i) {
+                GasketMode item = static_cast<GasketMode>(i);
+                if (ImGui::MenuItem(gasketModeName(item), NULL, mode == item)) { mode = item; }
+            }
+
+            ImGui::EndMenu();
+        }
+
+        // Item - Vertex layout (Triangles / Indexed)
+        if (ImGui::BeginMenu("Vertex Format"))
+        {
+            for (int i = 0; i < static_cast<int>(VertexFormat::Count); ++i) {
+                VertexFormat item = static_cast<VertexFormat>(i);
+                if (ImGui::MenuItem(vertexFormatName(item), NULL, format == item)) { format = item; }
+            }
+
+            ImGui::EndMenu();
+        }
+
+        // Item - how new levels reach the GPU
+        if (ImGui::BeginMenu("Upload Path"))
+        {
+            for (int i = 0; i < static_cast<int>(UploadPath::Count); ++i) {
+                UploadPath item = static_cast<UploadPath>(i);
+                if (ImGui::MenuItem(uploadPathName(item), NULL, upload == item)) { upload = item; }
+            }
+
+            ImGui::EndMenu();
+        }
+
+        // Item - LOD refinement threshold, in pixels of projected edge length
+        if (ImGui::BeginMenu("LOD Threshold"))
+        {
+            if (ImGui::MenuItem("0.5 px", NULL, lodPixels == 0.5f)) { lodPixels = 0.5f; }
+            if (ImGui::MenuItem("1 px", NULL, lodPixels == 1.0f)) { lodPixels = 1.0f; }
+            if (ImGui::MenuItem("2 px", NULL, lodPixels == 2.0f)) { lodPixels = 2.0f; }
+            if (ImGui::MenuItem("4 px", NULL, lodPixels == 4.0f)) { lodPixels = 4.0f; }
+
+            ImGui::EndMenu();
+        }
+
+        // Item - stream the gasket to a mesh file, at any level
+        if (ImGui::BeginMenu("Export"))
+        {
+            // the level range depends on the format, so the format is picked first and the write is its own item
+            for (int i = 0; i < static_cast<int>(ExportFormat::Count); ++i) {
+                ExportFormat item = static_cast<ExportFormat>(i);
+                if (ImGui::MenuItem(exportFormatName(item), NULL, exportFormat == item)) { exportFormat = item; }
+            }
+            exportLevel = std::min(exportLevel, GasketExport::maxLevel(exportFormat));
+            ImGui::SliderInt("Level", &exportLevel, 0, GasketExport::maxLevel(exportFormat));
+            if (ImGui::MenuItem("Write")) { exportRequested = true; }
 
             ImGui::EndMenu();
         }
 
         ImGui::Separator();
 
+        // Item - frame timing overlay
+        ImGui::MenuItem("Performance HUD", NULL, &showPerformance);
+
         // Item - Exit
         if (ImGui::MenuItem("Exit"))
         {
@@ -74,7 +151,89 @@ void UIManager::drawContextMenu(int& subdivisionLevel) {
     ImGui::End();
 }
 
+bool UIManager::wantsKeyboard() const {
+    return ImGui::GetIO().WantCaptureKeyboard;
+}
+
+void UIManager::drawBuildStatus(const char* stage, float progress) {
+    // small overlay in the bottom-left corner while a level is being built in the background
+    ImGuiIO& io = ImGui::GetIO();
+    ImGui::SetNextWindowPos(ImVec2(10.0f, io.DisplaySize.y - 10.0f), 0, ImVec2(0.0f, 1.0f));
+    ImGui::SetNextWindowBgAlpha(0.6f);
+
+    ImGuiWindowFlags window_flags = 0;
+    window_flags |= ImGuiWindowFlags_NoDecoration;
+    window_flags |= ImGuiWindowFlags_AlwaysAutoResize;
+    window_flags |= ImGuiWindowFlags_NoSavedSettings;
+    window_flags |= ImGuiWindowFlags_NoFocusOnAppearing;
+    window_flags |= ImGuiWindowFlags_NoNav;
+
+    ImGui::Begin("BuildStatus", NULL, window_flags);
+    ImGui::Text("%s...", stage);
+    ImGui::ProgressBar(progress, ImVec2(240.0f, 0.0f));
+    ImGui::End();
+}
+
+void UIManager::drawPerformance(const FrameStats& stats, const GeometryStats& geometry) {
+    ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f));
+    ImGui::SetNextWindowBgAlpha(0.6f);
+
+    ImGuiWindowFlags window_flags = 0;
+    window_flags |= ImGuiWindowFlags_NoDecoration;
+    window_flags |= ImGuiWindowFlags_AlwaysAutoResize;
+    window_flags |= ImGuiWindowFlags_NoSavedSettings;
+    window_flags |= ImGuiWindowFlags_NoFocusOnAppearing;
+    window_flags |= ImGuiWindowFlags_NoNav;
+    window_flags |= ImGuiWindowFlags_NoInputs;
+
+    ImGui::Begin("Performance", NULL, window_flags);
+
+    // one row per series: latest and rolling percentiles over the last FrameStats::History frames
+    auto row = [](const char* name, const FrameStats::Series& series) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn(); ImGui::TextUnformatted(name);
+        ImGui::TableNextColumn(); ImGui::Text("%.2f", series.latest());
+        ImGui::TableNextColumn(); ImGui::Text("%.2f", series.percentile(0.50f));
+        ImGui::TableNextColumn(); ImGui::Text("%.2f", series.percentile(0.95f));
+        ImGui::TableNextColumn(); ImGui::Text("%.2f", series.percentile(0.99f));
+    };
+    if (ImGui::BeginTable("FrameTimes", 5, ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("ms");
+        ImGui::TableSetupColumn("last");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p95");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableHeadersRow();
+        for (int phase = 0; phase < FrameStats::PhaseCount; ++phase) {
+            FrameStats::Phase p = static_cast<FrameStats::Phase>(phase);
+            row(FrameStats::phaseName(p), stats.cpu(p));
+        }
+        row("CPU frame", stats.cpuFrame());
+        row("GPU frame", stats.gpuFrame());
+        row("GPU scene", stats.gpuDraw());
+        ImGui::EndTable();
+    }
+
+    const FrameStats::Series& cpu = stats.cpuFrame();
+    const FrameStats::Series& gpu = stats.gpuFrame();
+    ImGui::PlotHistogram("CPU ms", cpu.Values, cpu.Count, cpu.plotOffset(), NULL, 0.0f, cpu.percentile(0.99f) * 1.25f,
+        ImVec2(320.0f, 50.0f));
+    ImGui::PlotHistogram("GPU ms", gpu.Values, gpu.Count, gpu.plotOffset(), NULL, 0.0f, gpu.percentile(0.99f) * 1.25f,
+        ImVec2(320.0f, 50.0f));
+
+    ImGui::Separator();
+    const double MB = 1.0 / (1 << 20);
+    ImGui::Text("Triangles drawn: %.3f M", geometry.Triangles * 1e-6);
+    ImGui::Text("Level buffers: %.1f MB GPU, %.1f MB CPU", geometry.LevelGpuBytes * MB, geometry.LevelCpuBytes * MB);
+    ImGui::Text("Geometry cache: %.1f MB in %zu levels", geometry.CacheBytes * MB, geometry.CachedLevels);
+    ImGui::Text("Geometry arena: %.1f MB used, %.1f MB reserved, %.1f MB peak", geometry.Arena.Used * MB,
+        geometry.Arena.Reserved * MB, geometry.Arena.Peak * MB);
+    ImGui::Text("Arena allocations: %zu, heap blocks: %zu", geometry.Arena.Allocations, geometry.Arena.HeapBlocks);
+    ImGui::End();
+}
+
 void UIManager::cleanup() {
+    if (!ImGui::GetCurrentContext()) return; // init() never ran
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -1,5 +1,13 @@
 #pragma once
 #include <GLFW/glfw3.h>
+#include <cstddef>
+#include "../core/FrameStats.h"
+#include "../rendering/Fractal.h"
+#include "../rendering/GasketExport.h"
+#include "../rendering/GasketMode.h"
+#include "../rendering/GeometryArena.h"
+#include "../rendering/UploadPath.h"
+#include "../rendering/VertexFormat.h"
 
 class UIManager
 {
@@ -9,5 +17,20 @@ public:
     void endFrame();
     void cleanup();
 
-    void drawContextMenu(int& subdivisionLevel);
+    // exportRequested is set when Export > Write is picked, with exportLevel / exportFormat to write
+    void drawContextMenu(int& subdivisionLevel, Fractal& shape, GasketMode& mode, VertexFormat& format, UploadPath& upload, float& lodPixels,
+        int& exportLevel, ExportFormat& exportFormat, bool& exportRequested, bool& showPerformance);
+    void drawBuildStatus(const char* stage, float progress);
+    bool wantsKeyboard() const; // a widget is taking text input, so keys are not for the camera
+
+    // overlay in the top-left corner: frame phases, GPU time, triangles drawn and the memory held by levels
+    struct GeometryStats {
+        size_t Triangles = 0;
+        size_t LevelGpuBytes = 0;
+        size_t LevelCpuBytes = 0;
+        size_t CacheBytes = 0; // every cached level, the current one included
+        size_t CachedLevels = 0;
+        ArenaStats Arena; // the blocks behind every level's vectors, see GeometryArena.h
+    };
+    void drawPerformance(const FrameStats& stats, const GeometryStats& geometry);
 };
\ No newline at end of file
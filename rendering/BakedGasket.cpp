@@ -0,0 +1,115 @@
+#include "BakedGasket.h"
+#include "GasketGeometry.h"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+
+namespace {
+    struct Vertex {
+        float x, y, z;
+    };
+    static_assert(sizeof(Vertex) == sizeof(glm::vec3), "baked vertices are uploaded as glm::vec3");
+
+    constexpr Vertex midpoint(const Vertex& a, const Vertex& b) {
+        return { 0.5f * (a.x + b.x), 0.5f * (a.y + b.y), 0.5f * (a.z + b.z) };
+    }
+
+    // std::sqrt is not constexpr; Newton's method settles on the double root, which rounds to the same float
+    constexpr double squareRoot(double x) {
+        double root = x;
+        for (int i = 0; i < 64; ++i) root = 0.5 * (root + x / root);
+        return root;
+    }
+
+    // baseVertices and faceColors, with the same float / double steps as GasketGeometry.cpp
+    constexpr float Sqrt3 = static_cast<float>(squareRoot(3.0));
+    constexpr float Sqrt6 = static_cast<float>(squareRoot(6.0));
+    constexpr Vertex Base[4] = {
+        { 0.0f, 0.0f, Sqrt6 / 4.0f },
+        { 0.0f, Sqrt3 / 3.0f, Sqrt6 / 12.0f },
+        { -0.5f, static_cast<float>(-Sqrt3 / 6.0), Sqrt6 / 12.0f },
+        { 0.5f, static_cast<float>(-Sqrt3 / 6.0), Sqrt6 / 12.0f }
+    };
+    constexpr Vertex Red = { 1.0f, 0.0f, 0.0f };
+    constexpr Vertex Green = { 0.0f, 1.0f, 0.0f };
+    constexpr Vertex Blue = { 0.0f, 0.0f, 1.0f };
+    constexpr Vertex Black = { 0.0f, 0.0f, 0.0f };
+
+    template <int Level>
+    struct Mesh {
+        static constexpr size_t Vertices = GasketGeometry::VerticesPerTetra << (2 * Level);
+        Vertex Positions[Vertices] = {};
+        Vertex Colors[Vertices] = {};
+    };
+
+    // emitTetra: red, black, blue, green
+    template <typename M>
+    constexpr void emit(const Vertex (&v)[4], M& mesh, size_t& next) {
+        const int corners[12] = { 0, 1, 2, 3, 2, 1, 0, 3, 1, 0, 2, 3 };
+        const Vertex colors[4] = { Red, Black, Blue, Green };
+        for (int i = 0; i < 12; ++i) {
+            mesh.Positions[next + i] = v[corners[i]];
+            mesh.Colors[next + i] = colors[i / 3];
+        }
+        next += 12;
+    }
+
+    // dividePyramid with the recursion unrolled on the depth: splitTetra order, child 0 first
+    template <int Depth, typename M>
+    constexpr void divide(const Vertex (&v)[4], M& mesh, size_t& next) {
+        if constexpr (Depth == 0) {
+            emit(v, mesh, next);
+        }
+        else {
+            Vertex m12 = midpoint(v[0], v[1]);
+            Vertex m13 = midpoint(v[0], v[2]);
+            Vertex m14 = midpoint(v[0], v[3]);
+            Vertex m23 = midpoint(v[1], v[2]);
+            Vertex m24 = midpoint(v[1], v[3]);
+            Vertex m34 = midpoint(v[2], v[3]);
+
+            const Vertex children[4][4] = {
+                { v[0], m12, m13, m14 },
+                { m12, v[1], m23, m24 },
+                { m13, m23, v[2], m34 },
+                { m14, m24, m34, v[3] }
+            };
+            for (int c = 0; c < 4; ++c) divide<Depth - 1>(children[c], mesh, next);
+        }
+    }
+
+    template <int Level>
+    constexpr Mesh<Level> bake() {
+        Mesh<Level> mesh;
+        size_t next = 0;
+        divide<Level>(Base, mesh, next);
+        return mesh;
+    }
+
+    constexpr Mesh<0> Level0 = bake<0>();
+    constexpr Mesh<1> Level1 = bake<1>();
+    constexpr Mesh<2> Level2 = bake<2>();
+    constexpr Mesh<3> Level3 = bake<3>();
+    constexpr Mesh<4> Level4 = bake<4>();
+    static_assert(BakedGasket::MaxLevel == 4, "one table per baked level");
+
+    template <int Level>
+    bool tables(const Mesh<Level>& mesh, const void*& positions, const void*& colors) {
+        positions = mesh.Positions;
+        colors = mesh.Colors;
+        return true;
+    }
+}
+
+bool BakedGasket::find(int level, const void*& positions, const void*& colors) {
+    switch (level) {
+    case 0: return tables(Level0, positions, colors);
+    case 1: return tables(Level1, positions, colors);
+    case 2: return tables(Level2, positions, colors);
+    case 3: return tables(Level3, positions, colors);
+    case 4: return tables(Level4, positions, colors);
+    default:
+        positions = colors = nullptr;
+        return false;
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Levels 0..MaxLevel of the Triangles mesh, generated by the compiler into read-only tables.
+// They are the levels the menu offers and the one the app starts at, so those never cost a build:
+// their Float32 streams are uploaded straight from the binary.
+namespace BakedGasket {
+    constexpr int MaxLevel = 4; // 3072 vertices, 72 KB of positions + colors
+
+    // positions / colors exactly as GasketGeometry::generate(level) writes them, vertexCount(level)
+    // packed xyz floats each (the layout of glm::vec3); false above MaxLevel
+    bool find(int level, const void*& positions, const void*& colors);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+
+// thrown out of a geometry build once its BuildProgress has been cancelled
+class BuildCancelled : public std::runtime_error {
+public:
+    BuildCancelled() : std::runtime_error("Geometry build cancelled") {}
+};
+
+// Shared between a background geometry build and the thread waiting for it.
+// Work is counted in whatever units the build documents; Total is set before it starts.
+struct BuildProgress {
+    std::atomic<size_t> Done{ 0 };
+    std::atomic<size_t> Total{ 1 };
+    std::atomic<bool> Cancelled{ false };
+
+    // record n more units of work; throws BuildCancelled if the build should stop
+    void advance(size_t n) {
+        if (Cancelled.load(std::memory_order_relaxed)) throw BuildCancelled();
+        Done.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    float fraction() const {
+        size_t total = Total.load(std::memory_order_relaxed);
+        size_t done = Done.load(std::memory_order_relaxed);
+        return total > 0 && done < total ? static_cast<float>(done) / static_cast<float>(total) : 1.0f;
+    }
+};
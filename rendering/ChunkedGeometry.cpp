@@ -0,0 +1,110 @@
+#include "ChunkedGeometry.h"
+#include "GasketGeometry.h"
+#include "../core/ThreadPool.h"
+#include "../core/Trace.h"
+
+#include <algorithm>
+#include <cstdint>
+
+ChunkedGeometry::ChunkedGeometry(int level, size_t budget)
+    : Level(level), Depth(level > ChunkLevel ? level - ChunkLevel : 0) {
+    ChunkVertices = GasketGeometry::vertexCount(Level - Depth);
+
+    size_t slotBytes = 2 * ChunkVertices * sizeof(glm::vec3);
+    uint64_t chunks = GasketGeometry::tetraCount(Depth);
+    Slots = std::max<size_t>(budget / slotBytes, 1);
+    if (Slots > chunks) Slots = static_cast<size_t>(chunks);
+    // first vertex of every slot must fit the GLint of glMultiDrawArrays
+    size_t maxSlots = static_cast<size_t>(INT32_MAX) / ChunkVertices;
+    if (Slots > maxSlots) Slots = maxSlots;
+
+    SlotChunk.assign(Slots, EmptySlot);
+    SlotFrame.assign(Slots, 0);
+    StagingPositions.resize(ChunksPerFrame * ChunkVertices);
+    StagingColors.resize(ChunksPerFrame * ChunkVertices);
+
+    size_t bytes = Slots * ChunkVertices * sizeof(glm::vec3);
+    glCreateBuffers(1, &VBO_Position);
+    glCreateBuffers(1, &VBO_Color);
+    glNamedBufferStorage(VBO_Position, bytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glNamedBufferStorage(VBO_Color, bytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    // the colors only depend on the vertex position within a leaf
+    GasketGeometry::dividePyramid(GasketGeometry::baseVertices, Level - Depth, StagingPositions.data(), StagingColors.data());
+    size_t chunkBytes = ChunkVertices * sizeof(glm::vec3);
+    for (size_t slot = 0; slot < Slots; ++slot) {
+        glNamedBufferSubData(VBO_Color, slot * chunkBytes, chunkBytes, StagingColors.data());
+    }
+}
+
+ChunkedGeometry::~ChunkedGeometry() {
+    if (VBO_Position != 0) glDeleteBuffers(1, &VBO_Position);
+    if (VBO_Color != 0) glDeleteBuffers(1, &VBO_Color);
+}
+
+void ChunkedGeometry::update(const glm::mat4& view, const glm::mat4& projection, ThreadPool* pool) {
+    TRACE_ZONE("ChunkedGeometry::update");
+    ++Frame;
+    GasketGeometry::selectChunks(view, projection, Depth, Slots, Wanted);
+
+    std::vector<uint64_t> missing;
+    for (uint64_t chunk : Wanted) {
+        auto found = Resident.find(chunk);
+        if (found != Resident.end()) {
+            SlotFrame[found->second] = Frame;
+        }
+        else {
+            missing.push_back(chunk);
+        }
+    }
+
+    // slots not visible this frame can be reused, least recently visible (or empty) first
+    std::vector<size_t> victims;
+    for (size_t slot = 0; slot < Slots; ++slot) {
+        if (SlotFrame[slot] != Frame) victims.push_back(slot);
+    }
+    size_t count = std::min({ missing.size(), victims.size(), size_t(ChunksPerFrame) });
+    std::partial_sort(victims.begin(), victims.begin() + count, victims.end(),
+        [this](size_t a, size_t b) { return SlotFrame[a] < SlotFrame[b]; });
+
+    // the nearest missing chunks first; they were selected in that order
+    auto generate = [&](size_t i) {
+        glm::vec3 corners[4];
+        GasketGeometry::subtreeCorners(missing[i], Depth, corners);
+        GasketGeometry::dividePyramid(corners, Level - Depth, StagingPositions.data() + i * ChunkVertices,
+            StagingColors.data() + i * ChunkVertices);
+    };
+    if (pool && count > 1) {
+        pool->parallelFor(count, generate);
+    }
+    else {
+        for (size_t i = 0; i < count; ++i) generate(i);
+    }
+
+    size_t chunkBytes = ChunkVertices * sizeof(glm::vec3);
+    for (size_t i = 0; i < count; ++i) {
+        size_t slot = victims[i];
+        if (SlotChunk[slot] != EmptySlot) Resident.erase(SlotChunk[slot]);
+        glNamedBufferSubData(VBO_Position, slot * chunkBytes, chunkBytes, StagingPositions.data() + i * ChunkVertices);
+        SlotChunk[slot] = missing[i];
+        SlotFrame[slot] = Frame;
+        Resident[missing[i]] = slot;
+    }
+    Missing = missing.size() - count;
+
+    // front to back, so near chunks fill the depth buffer first
+    First.clear();
+    Count.clear();
+    for (uint64_t chunk : Wanted) {
+        auto found = Resident.find(chunk);
+        if (found == Resident.end()) continue;
+        First.push_back(static_cast<GLint>(found->second * ChunkVertices));
+        Count.push_back(static_cast<GLsizei>(ChunkVertices));
+    }
+}
+
+size_t ChunkedGeometry::draw() const {
+    if (First.empty()) return 0;
+    glMultiDrawArrays(GL_TRIANGLES, First.data(), Count.data(), static_cast<GLsizei>(First.size()));
+    return First.size() * ChunkVertices;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+// A Triangles level too big for one buffer or for VRAM, cut into subtrees of ChunkLevel levels.
+// A fixed number of slots, as many as the budget allows, holds the chunks the view needs most;
+// missing chunks are generated a few per frame into the least recently drawn slots.
+// The resident visible chunks are drawn with one glMultiDrawArrays. Needs the GL context.
+class ChunkedGeometry {
+public:
+    static constexpr int ChunkLevel = 6; // 4096 leaves, 1.1 MB of Float32 vertices per chunk
+    static constexpr int ChunksPerFrame = 16;
+    static constexpr size_t DefaultBudget = size_t(512) << 20;
+
+    ChunkedGeometry(int level, size_t budget); // budget: GPU bytes for the slots, at least one slot
+    ~ChunkedGeometry();
+
+    ChunkedGeometry(const ChunkedGeometry&) = delete;
+    ChunkedGeometry& operator=(const ChunkedGeometry&) = delete;
+
+    // select the visible chunks, nearest first, and stream in up to ChunksPerFrame missing ones;
+    // pool may be nullptr, and must not be in use by another thread
+    void update(const glm::mat4& view, const glm::mat4& projection, ThreadPool* pool);
+    size_t draw() const; // with the VAO bound to positionBuffer() / colorBuffer(); returns the vertices drawn
+
+    GLuint positionBuffer() const { return VBO_Position; }
+    GLuint colorBuffer() const { return VBO_Color; }
+    size_t gpuBytes() const { return 2 * Slots * ChunkVertices * sizeof(glm::vec3); }
+
+    size_t slotCount() const { return Slots; }
+    size_t visibleCount() const { return Wanted.size(); }
+    size_t missingCount() const { return Missing; } // visible, not resident yet
+
+private:
+    static constexpr uint64_t EmptySlot = ~uint64_t(0);
+
+    int Level;
+    int Depth; // chunks are the subtrees at this depth
+    size_t ChunkVertices;
+    size_t Slots;
+
+    GLuint VBO_Position = 0;
+    GLuint VBO_Color = 0; // every chunk has the same color pattern, written once
+
+    std::vector<uint64_t> SlotChunk; // subtree index held by each slot, or EmptySlot
+    std::vector<uint64_t> SlotFrame; // last frame each slot was visible
+    std::unordered_map<uint64_t, size_t> Resident; // subtree index -> slot
+    uint64_t Frame = 0;
+
+    std::vector<uint64_t> Wanted; // visible chunks this frame, nearest first
+    size_t Missing = 0;
+    std::vector<GLint> First;
+    std::vector<GLsizei> Count;
+
+    std::vector<glm::vec3> StagingPositions; // ChunksPerFrame chunks
+    std::vector<glm::vec3> StagingColors;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "GasketMode.h"
+
+// which self-similar shape is subdivided (IfsRules.h); every mode draws the tetrahedron,
+// the others always go through the Triangles path
+enum class Fractal {
+    Tetrahedron, // Sierpinski tetrahedron: 4 corner children, central octahedron removed
+    Triangle,    // Sierpinski triangle: 3 corner children, flat in z = 0
+    Menger,      // Menger sponge: 20 of the 27 sub-cubes
+    Octahedron,  // octahedron flake: 6 children at the vertices
+    Count
+};
+
+inline const char* fractalName(Fractal fractal) {
+    switch (fractal) {
+    case Fractal::Tetrahedron: return "Sierpinski tetrahedron";
+    case Fractal::Triangle: return "Sierpinski triangle";
+    case Fractal::Menger: return "Menger sponge";
+    case Fractal::Octahedron: return "Octahedron flake";
+    default: return "?";
+    }
+}
+
+// deepest level worth building as plain triangles (a few million vertices at most),
+// except the tetrahedron, whose real limit is the mode's
+constexpr int fractalMaxLevel(Fractal fractal) {
+    switch (fractal) {
+    case Fractal::Tetrahedron: return 20;
+    case Fractal::Triangle: return 12;
+    case Fractal::Menger: return 4;
+    case Fractal::Octahedron: return 7;
+    default: return 0;
+    }
+}
+
+// deepest level the shape can be drawn at in this mode (the others are always Triangles)
+inline int fractalMaxLevel(Fractal fractal, GasketMode mode) {
+    if (fractal != Fractal::Tetrahedron) return fractalMaxLevel(fractal);
+    return gasketModeMaxLevel(mode);
+}
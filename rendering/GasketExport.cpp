@@ -0,0 +1,250 @@
+#include "GasketExport.h"
+#include "BuildProgress.h"
+#include "GasketGeometry.h"
+#include "../core/ThreadPool.h"
+#include "../core/Trace.h"
+
+#include <glm/glm.hpp>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    using GasketGeometry::VerticesPerTetra;
+
+    // corners of the 4 faces of a leaf and their colors, in emitTetra order (red, black, blue, green)
+    const int FaceCorners[4][3] = { { 0, 1, 2 }, { 3, 2, 1 }, { 0, 3, 1 }, { 0, 2, 3 } };
+    const int FaceColor[4] = { 0, 3, 2, 1 };
+
+    // every leaf is a scaled, translated base tetra, so the 4 face normals never change
+    struct FaceNormals {
+        glm::vec3 n[4];
+
+        FaceNormals() {
+            const glm::vec3* v = GasketGeometry::baseVertices;
+            for (int f = 0; f < 4; ++f) {
+                const int* c = FaceCorners[f];
+                n[f] = glm::normalize(glm::cross(v[c[1]] - v[c[0]], v[c[2]] - v[c[0]]));
+            }
+        }
+    };
+
+    // little-endian writers, whatever the host
+    void putU8(char*& out, uint8_t value) {
+        *out++ = static_cast<char>(value);
+    }
+
+    void putU16(char*& out, uint16_t value) {
+        putU8(out, static_cast<uint8_t>(value));
+        putU8(out, static_cast<uint8_t>(value >> 8));
+    }
+
+    void putU32(char*& out, uint32_t value) {
+        putU16(out, static_cast<uint16_t>(value));
+        putU16(out, static_cast<uint16_t>(value >> 16));
+    }
+
+    void putF32(char*& out, float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        putU32(out, bits);
+    }
+
+    void putVec3(char*& out, const glm::vec3& v) {
+        putF32(out, v.x);
+        putF32(out, v.y);
+        putF32(out, v.z);
+    }
+
+    // text output with the shortest representation that reads back to the same float
+    void putText(char*& out, float value) {
+        out = std::to_chars(out, out + 32, value).ptr;
+    }
+
+    void putText(char*& out, uint64_t value) {
+        out = std::to_chars(out, out + 24, value).ptr;
+    }
+
+    // bytes written per leaf and pass; an upper bound for OBJ
+    size_t leafBytes(ExportFormat format, int pass) {
+        switch (format) {
+        case ExportFormat::Stl: return 4 * 50;
+        case ExportFormat::Ply: return pass == 0 ? 4 * 12 : 4 * 16;
+        default: return 4 * (2 + 3 * 16) + 4 * (2 + 3 * 21);
+        }
+    }
+
+    int passCount(ExportFormat format) {
+        return format == ExportFormat::Ply ? 2 : 1;
+    }
+
+    std::string header(ExportFormat format, int level) {
+        size_t leaves = GasketGeometry::tetraCount(level);
+        std::string comment = "Sierpinski tetra gasket, level " + std::to_string(level);
+        switch (format) {
+        case ExportFormat::Stl: {
+            std::string text(80, ' ');
+            text.replace(0, comment.size(), comment);
+            char count[4];
+            char* out = count;
+            putU32(out, static_cast<uint32_t>(4 * leaves));
+            return text + std::string(count, 4);
+        }
+        case ExportFormat::Ply:
+            return "ply\nformat binary_little_endian 1.0\ncomment " + comment + "\n"
+                "element vertex " + std::to_string(4 * leaves) + "\n"
+                "property float x\nproperty float y\nproperty float z\n"
+                "element face " + std::to_string(4 * leaves) + "\n"
+                "property list uchar uint vertex_indices\n"
+                "property uchar red\nproperty uchar green\nproperty uchar blue\n"
+                "end_header\n";
+        default:
+            return "# " + comment + "\n";
+        }
+    }
+
+    // One chunk: the leaves of one subtree, generated into scratch and encoded into bytes.
+    struct Chunk {
+        std::vector<glm::vec3> Positions;
+        std::vector<glm::vec3> Colors;
+        std::vector<char> Bytes;
+        size_t Size = 0; // bytes used
+    };
+
+    void encodeChunk(ExportFormat format, int pass, int splitDepth, int subLevel, size_t s, Chunk& chunk) {
+        static const FaceNormals normals;
+
+        size_t leaves = GasketGeometry::tetraCount(subLevel);
+        size_t firstLeaf = s * leaves;
+        chunk.Bytes.resize(leaves * leafBytes(format, pass) + 32); // slack for the last to_chars
+        char* out = chunk.Bytes.data();
+
+        // PLY faces only need the leaf index
+        bool geometry = !(format == ExportFormat::Ply && pass == 1);
+        if (geometry) {
+            chunk.Positions.resize(GasketGeometry::vertexCount(subLevel));
+            chunk.Colors.resize(GasketGeometry::vertexCount(subLevel));
+            glm::vec3 corners[4];
+            GasketGeometry::subtreeCorners(s, splitDepth, corners);
+            GasketGeometry::dividePyramid(corners, subLevel, chunk.Positions.data(), chunk.Colors.data());
+        }
+
+        for (size_t leaf = 0; leaf < leaves; ++leaf) {
+            // the first 4 vertices a leaf emits are its corners
+            const glm::vec3* v = geometry ? chunk.Positions.data() + leaf * VerticesPerTetra : nullptr;
+            uint64_t firstVertex = 4 * (firstLeaf + leaf);
+
+            switch (format) {
+            case ExportFormat::Stl:
+                for (int f = 0; f < 4; ++f) {
+                    putVec3(out, normals.n[f]);
+                    for (int c : FaceCorners[f]) putVec3(out, v[c]);
+                    putU16(out, 0);
+                }
+                break;
+            case ExportFormat::Ply:
+                if (pass == 0) {
+                    for (int c = 0; c < 4; ++c) putVec3(out, v[c]);
+                    break;
+                }
+                for (int f = 0; f < 4; ++f) {
+                    putU8(out, 3);
+                    for (int c : FaceCorners[f]) putU32(out, static_cast<uint32_t>(firstVertex + c));
+                    const glm::vec3& color = GasketGeometry::faceColors[FaceColor[f]];
+                    putU8(out, static_cast<uint8_t>(color.x * 255.0f));
+                    putU8(out, static_cast<uint8_t>(color.y * 255.0f));
+                    putU8(out, static_cast<uint8_t>(color.z * 255.0f));
+                }
+                break;
+            default:
+                for (int c = 0; c < 4; ++c) {
+                    *out++ = 'v';
+                    for (float coordinate : { v[c].x, v[c].y, v[c].z }) {
+                        *out++ = ' ';
+                        putText(out, coordinate);
+                    }
+                    *out++ = '\n';
+                }
+                for (int f = 0; f < 4; ++f) {
+                    *out++ = 'f';
+                    for (int c : FaceCorners[f]) {
+                        *out++ = ' ';
+                        putText(out, firstVertex + c + 1); // OBJ indices start at 1
+                    }
+                    *out++ = '\n';
+                }
+                break;
+            }
+        }
+        chunk.Size = static_cast<size_t>(out - chunk.Bytes.data());
+    }
+
+    void writeChunks(std::ofstream& file, ExportFormat format, int level, ThreadPool* pool, BuildProgress* progress) {
+        int splitDepth = level > GasketExport::ChunkDepth ? level - GasketExport::ChunkDepth : 0;
+        int subLevel = level - splitDepth;
+        size_t chunkCount = GasketGeometry::tetraCount(splitDepth);
+        size_t chunkLeaves = GasketGeometry::tetraCount(subLevel);
+
+        // a couple of chunks per thread in flight; only this window is ever held in memory
+        size_t window = pool ? size_t(pool->size()) * 2 : 1;
+        std::vector<Chunk> chunks(window);
+
+        for (int pass = 0; pass < passCount(format); ++pass) {
+            for (size_t first = 0; first < chunkCount; first += window) {
+                size_t count = (chunkCount - first < window) ? chunkCount - first : window;
+                if (pool && count > 1) {
+                    pool->parallelFor(count, [&](size_t i) {
+                        encodeChunk(format, pass, splitDepth, subLevel, first + i, chunks[i]);
+                    });
+                }
+                else {
+                    for (size_t i = 0; i < count; ++i) encodeChunk(format, pass, splitDepth, subLevel, first + i, chunks[i]);
+                }
+
+                for (size_t i = 0; i < count; ++i) {
+                    file.write(chunks[i].Bytes.data(), static_cast<std::streamsize>(chunks[i].Size));
+                }
+                if (!file) throw std::runtime_error("Failed to write export file");
+                if (progress) progress->advance(count * chunkLeaves);
+            }
+        }
+    }
+}
+
+int GasketExport::maxLevel(ExportFormat format) {
+    // 4 * 4^14 triangles / vertices is the last count below 2^32
+    return format == ExportFormat::Obj ? GasketGeometry::MaxLevel : 14;
+}
+
+void GasketExport::write(const std::string& path, ExportFormat format, int level, ThreadPool* pool, BuildProgress* progress) {
+    TRACE_ZONE("GasketExport::write");
+    if (level < 0 || level > maxLevel(format)) {
+        throw std::invalid_argument(std::string(exportFormatName(format)) + " export level out of range: " + std::to_string(level));
+    }
+    if (progress) progress->Total = GasketGeometry::tetraCount(level) * passCount(format);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Cannot create export file: " + path);
+    }
+
+    try {
+        std::string text = header(format, level);
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+        writeChunks(file, format, level, pool, progress);
+        file.close();
+        if (!file) throw std::runtime_error("Failed to write export file: " + path);
+    }
+    catch (...) {
+        // never leave a truncated mesh behind
+        file.close();
+        std::remove(path.c_str());
+        throw;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+
+class ThreadPool;
+struct BuildProgress;
+
+// mesh file formats the gasket can be exported to
+enum class ExportFormat {
+    Stl, // binary STL: 4 triangles per leaf with face normals, no color
+    Ply, // binary little-endian PLY: 4 vertices + 4 colored faces per leaf
+    Obj, // text OBJ: 4 vertices + 4 faces per leaf, geometry only
+    Count
+};
+
+inline const char* exportFormatName(ExportFormat format) {
+    switch (format) {
+    case ExportFormat::Stl: return "STL (binary)";
+    case ExportFormat::Ply: return "PLY (binary)";
+    case ExportFormat::Obj: return "OBJ (text)";
+    default: return "?";
+    }
+}
+
+inline const char* exportExtension(ExportFormat format) {
+    switch (format) {
+    case ExportFormat::Stl: return "stl";
+    case ExportFormat::Ply: return "ply";
+    case ExportFormat::Obj: return "obj";
+    default: return "bin";
+    }
+}
+
+// Streams the gasket to a file without holding the mesh in memory.
+// The leaves are generated by dividePyramid in subtrees of at most 4^ChunkDepth leaves, each encoded
+// into its own chunk and written in depth-first order, so memory stays bounded at any level.
+namespace GasketExport {
+    constexpr int ChunkDepth = 6; // 4096 leaves per chunk
+
+    // deepest level the format can count: STL and PLY store 32-bit triangle counts / vertex indices
+    int maxLevel(ExportFormat format);
+
+    // With a pool, chunks are encoded on the pool a window at a time and still written in order;
+    // the output is byte-identical either way. write() sets the progress Total: one unit per leaf and
+    // pass (PLY writes all vertices, then all faces). A cancelled or failed export removes the partial
+    // file and throws.
+    void write(const std::string& path, ExportFormat format, int level, ThreadPool* pool = nullptr,
+        BuildProgress* progress = nullptr);
+}
@@ -0,0 +1,431 @@
+#include "GasketGeometry.h"
+#include "BuildProgress.h"
+#include "LeafKernel.h"
+#include "../core/ThreadPool.h"
+#include "../core/Trace.h"
+
+#include <cmath>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace GasketGeometry {
+
+const glm::vec3 baseVertices[4] = {
+    glm::vec3(0.0f, 0.0f, sqrt(6.0f) / 4.0f),                   // v[0]
+    glm::vec3(0.0f, sqrt(3.0f) / 3.0f, sqrt(6.0f) / 12.0f),     // v[1]
+    glm::vec3(-0.5f, -sqrt(3.0f) / 6.0, sqrt(6.0f) / 12.0f),    // v[2]
+    glm::vec3(0.5f, -sqrt(3.0f) / 6.0, sqrt(6.0f) / 12.0f)      // v[3]
+};
+
+const glm::vec3 faceColors[4] = {
+    glm::vec3(1.0f, 0.0f, 0.0f), // Red
+    glm::vec3(0.0, 1.0, 0.0),    // Green
+    glm::vec3(0.0f, 0.0f, 1.0f), // Blue
+    glm::vec3(0.0f, 0.0f, 0.0f)  // Black
+};
+
+// slices a background build is cut into, so it can report progress and stop early
+static constexpr size_t ProgressSlices = 256;
+
+static void checkLevel(int level) {
+    if (level < 0 || level > MaxLevel) {
+        throw std::invalid_argument("Subdivision level out of range: " + std::to_string(level));
+    }
+}
+
+size_t tetraCount(int level) {
+    checkLevel(level);
+    return size_t(1) << (2 * level);
+}
+
+size_t vertexCount(int level) {
+    return VerticesPerTetra * tetraCount(level);
+}
+
+void splitTetra(const glm::vec3 (&parent)[4], glm::vec3 (&children)[4][4]) {
+    const glm::vec3& v1 = parent[0];
+    const glm::vec3& v2 = parent[1];
+    const glm::vec3& v3 = parent[2];
+    const glm::vec3& v4 = parent[3];
+
+    // calculate midpoints of each edge
+    glm::vec3 m12 = 0.5f * (v1 + v2);
+    glm::vec3 m13 = 0.5f * (v1 + v3);
+    glm::vec3 m14 = 0.5f * (v1 + v4);
+    glm::vec3 m23 = 0.5f * (v2 + v3);
+    glm::vec3 m24 = 0.5f * (v2 + v4);
+    glm::vec3 m34 = 0.5f * (v3 + v4);
+
+    children[0][0] = v1;  children[0][1] = m12; children[0][2] = m13; children[0][3] = m14;
+    children[1][0] = m12; children[1][1] = v2;  children[1][2] = m23; children[1][3] = m24;
+    children[2][0] = m13; children[2][1] = m23; children[2][2] = v3;  children[2][3] = m34;
+    children[3][0] = m14; children[3][1] = m24; children[3][2] = m34; children[3][3] = v4;
+}
+
+void subtreeCorners(uint64_t index, int depth, glm::vec3 (&corners)[4]) {
+    checkLevel(depth);
+    for (int i = 0; i < 4; ++i) corners[i] = baseVertices[i];
+
+    // one base-4 digit per depth picks the child, most significant first
+    for (int d = depth - 1; d >= 0; --d) {
+        glm::vec3 children[4][4];
+        splitTetra(corners, children);
+        int c = static_cast<int>((index >> (2 * d)) & 3);
+        for (int i = 0; i < 4; ++i) corners[i] = children[c][i];
+    }
+}
+
+// the face colors are the same for every tetra
+static void emitColors(glm::vec3* colors) {
+    colors[0] = colors[1] = colors[2] = faceColors[0];
+    colors[3] = colors[4] = colors[5] = faceColors[3];
+    colors[6] = colors[7] = colors[8] = faceColors[2];
+    colors[9] = colors[10] = colors[11] = faceColors[1];
+}
+
+void emitTetra(const glm::vec3 (&v)[4], glm::vec3* positions, glm::vec3* colors) {
+    // Red
+    positions[0] = v[0]; positions[1] = v[1]; positions[2] = v[2];
+    // Black
+    positions[3] = v[3]; positions[4] = v[2]; positions[5] = v[1];
+    // Blue
+    positions[6] = v[0]; positions[7] = v[3]; positions[8] = v[1];
+    // Green
+    positions[9] = v[0]; positions[10] = v[2]; positions[11] = v[3];
+
+    emitColors(colors);
+}
+
+// Collects the parents of the leaves (depth level - 1) in SoA form
+// and hands them to the widest LeafKernel this CPU supports.
+class LeafBatcher {
+public:
+    LeafBatcher(glm::vec3* positions, glm::vec3* colors)
+        : Positions(positions), Colors(colors), Run(LeafKernel::best()) {
+    }
+
+    void add(const glm::vec3 (&parent)[4]) {
+        for (int i = 0; i < 4; ++i) {
+            Batch.x[i][Count] = parent[i].x;
+            Batch.y[i][Count] = parent[i].y;
+            Batch.z[i][Count] = parent[i].z;
+        }
+        if (++Count == LeafKernel::BatchCapacity) flush();
+    }
+
+    void flush() {
+        if (Count == 0) return;
+
+        Run(Batch, Count, &Positions->x);
+        for (int n = 0; n < Count * 4; ++n) {
+            emitColors(Colors);
+            Colors += VerticesPerTetra;
+        }
+        Positions += Count * LeafKernel::VerticesPerParent;
+        Count = 0;
+    }
+
+private:
+    LeafKernel::ParentBatch Batch = {};
+    int Count = 0;
+    glm::vec3* Positions;
+    glm::vec3* Colors;
+    LeafKernel::Kernel Run;
+};
+
+void dividePyramid(const glm::vec3 (&corners)[4], int level, glm::vec3* positions, glm::vec3* colors) {
+    TRACE_ZONE("dividePyramid");
+    checkLevel(level);
+    if (level == 0) {
+        emitTetra(corners, positions, colors);
+        return;
+    }
+
+    LeafBatcher leaves(positions, colors);
+    if (level == 1) {
+        leaves.add(corners);
+        leaves.flush();
+        return;
+    }
+
+    // one frame per depth: the 4 children of the node and the next child to visit
+    struct Frame {
+        glm::vec3 children[4][4];
+        int next;
+    };
+    Frame stack[MaxLevel];
+
+    int top = 0;
+    splitTetra(corners, stack[0].children);
+    stack[0].next = 0;
+
+    while (top >= 0) {
+        Frame& frame = stack[top];
+
+        // children of the deepest frame are the parents of the leaves
+        if (top == level - 2) {
+            for (int c = 0; c < 4; ++c) {
+                leaves.add(frame.children[c]);
+            }
+            --top;
+            continue;
+        }
+
+        if (frame.next == 4) {
+            --top;
+            continue;
+        }
+
+        splitTetra(frame.children[frame.next++], stack[top + 1].children);
+        stack[top + 1].next = 0;
+        ++top;
+    }
+    leaves.flush();
+}
+
+void generate(int level, glm::vec3* positions, glm::vec3* colors) {
+    dividePyramid(baseVertices, level, positions, colors);
+}
+
+void generateOffsets(int level, glm::vec3* offsets) {
+    checkLevel(level);
+
+    // child c of (scale s, offset t) is (s / 2, t + s / 2 * baseVertices[c]).
+    // Expand one depth at a time in place; node i's children go to 4i..4i+3, which is dividePyramid order.
+    // Walking i downwards never overwrites a node that has not been expanded yet.
+    offsets[0] = glm::vec3(0.0f);
+    size_t count = 1;
+    float scale = 1.0f;
+    for (int depth = 0; depth < level; ++depth) {
+        scale *= 0.5f;
+        glm::vec3 delta[4];
+        for (int c = 0; c < 4; ++c) delta[c] = scale * baseVertices[c];
+
+        for (size_t i = count; i-- > 0;) {
+            glm::vec3 t = offsets[i];
+            for (int c = 0; c < 4; ++c) offsets[4 * i + c] = t + delta[c];
+        }
+        count *= 4;
+    }
+}
+
+// leaves [first, last) of the parent level, each split once more
+static void refineRange(const glm::vec3* parentPositions, size_t first, size_t last, glm::vec3* positions, glm::vec3* colors) {
+    LeafBatcher leaves(positions + first * LeafKernel::VerticesPerParent, colors + first * LeafKernel::VerticesPerParent);
+    for (size_t i = first; i < last; ++i) {
+        // emitTetra writes v0, v1, v2 (red face) and then v3 (black face)
+        const glm::vec3* leaf = parentPositions + i * VerticesPerTetra;
+        const glm::vec3 corners[4] = { leaf[0], leaf[1], leaf[2], leaf[3] };
+        leaves.add(corners);
+    }
+    leaves.flush();
+}
+
+void refine(int level, const glm::vec3* parentPositions, glm::vec3* positions, glm::vec3* colors) {
+    checkLevel(level + 1);
+    refineRange(parentPositions, 0, tetraCount(level), positions, colors);
+}
+
+void refine(int level, const glm::vec3* parentPositions, glm::vec3* positions, glm::vec3* colors, ThreadPool& pool,
+    BuildProgress* progress) {
+    checkLevel(level + 1);
+
+    // a background build also wants enough slices to report progress and notice cancellation
+    size_t parents = tetraCount(level);
+    size_t chunks = size_t(pool.size()) * 4;
+    if (progress && chunks < ProgressSlices) chunks = ProgressSlices;
+    if (parents < chunks || (pool.size() == 1 && !progress)) {
+        refineRange(parentPositions, 0, parents, positions, colors);
+        if (progress) progress->advance(parents * 4);
+        return;
+    }
+
+    // every parent owns a fixed 48-vertex slice of the output, so chunks need no locking
+    size_t perChunk = (parents + chunks - 1) / chunks;
+    pool.parallelFor(chunks, [&](size_t c) {
+        size_t first = c * perChunk;
+        size_t last = first + perChunk < parents ? first + perChunk : parents;
+        if (first >= last) return;
+        if (progress) progress->advance(0);
+        TRACE_ZONE("refine slice");
+        refineRange(parentPositions, first, last, positions, colors);
+        if (progress) progress->advance((last - first) * 4);
+    });
+}
+
+void refineOffsets(int level, const glm::vec3* parentOffsets, glm::vec3* offsets) {
+    checkLevel(level + 1);
+
+    // one step of generateOffsets' expansion, out of place
+    float scale = std::ldexp(1.0f, -(level + 1));
+    glm::vec3 delta[4];
+    for (int c = 0; c < 4; ++c) delta[c] = scale * baseVertices[c];
+
+    size_t count = tetraCount(level);
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 4; ++c) offsets[4 * i + c] = parentOffsets[i] + delta[c];
+    }
+}
+
+// frustum planes (Gribb & Hartmann), normalized so plane distance is in world units
+void frustumPlanes(const glm::mat4& viewProjection, glm::vec4 (&planes)[6]) {
+    for (int i = 0; i < 3; ++i) {
+        glm::vec4 row(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        glm::vec4 w(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+        planes[2 * i] = w + row;
+        planes[2 * i + 1] = w - row;
+    }
+    for (glm::vec4& plane : planes) {
+        plane = plane / glm::length(glm::vec3(plane.x, plane.y, plane.z));
+    }
+}
+
+bool outsideFrustum(const glm::vec4 (&planes)[6], const glm::vec3& center, float radius) {
+    for (const glm::vec4& plane : planes) {
+        if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius) return true;
+    }
+    return false;
+}
+
+void selectLod(const LodView& lod, std::vector<glm::vec4>& nodes) {
+    TRACE_ZONE("GasketGeometry::selectLod");
+    checkLevel(lod.maxLevel);
+    nodes.clear();
+
+    // bounding sphere of the base tetra (edge length 1): centroid and circumradius
+    glm::vec3 centroid = 0.25f * (baseVertices[0] + baseVertices[1] + baseVertices[2] + baseVertices[3]);
+    float radius = glm::length(baseVertices[0] - centroid);
+
+    glm::mat4 viewProjection = lod.projection * lod.view;
+    glm::vec4 planes[6];
+    frustumPlanes(viewProjection, planes);
+
+    // pixels per world unit at clip w = 1 (vertical)
+    float pixelsPerUnit = lod.projection[1][1] * 0.5f * lod.viewportHeight;
+
+    struct Node {
+        glm::vec3 offset;
+        float scale;
+        int depth;
+    };
+    std::vector<Node> stack;
+    stack.reserve(3 * lod.maxLevel + 4);
+    stack.push_back({ glm::vec3(0.0f), 1.0f, 0 });
+
+    while (!stack.empty()) {
+        Node node = stack.back();
+        stack.pop_back();
+
+        glm::vec3 center = node.scale * centroid + node.offset;
+        if (outsideFrustum(planes, center, node.scale * radius)) continue;
+
+        float w = (viewProjection * glm::vec4(center, 1.0f)).w;
+        float edgePixels = node.scale * pixelsPerUnit / (w > 1e-6f ? w : 1e-6f);
+
+        if (node.depth >= lod.maxLevel || edgePixels < lod.pixelThreshold) {
+            nodes.push_back(glm::vec4(node.offset, node.scale));
+            continue;
+        }
+
+        // push in reverse so children come out in dividePyramid order
+        float half = 0.5f * node.scale;
+        for (int c = 3; c >= 0; --c) {
+            stack.push_back({ node.offset + half * baseVertices[c], half, node.depth + 1 });
+        }
+    }
+}
+
+void selectChunks(const glm::mat4& view, const glm::mat4& projection, int depth, size_t maxCount,
+    std::vector<uint64_t>& chunks) {
+    checkLevel(depth);
+    chunks.clear();
+
+    glm::vec3 centroid = 0.25f * (baseVertices[0] + baseVertices[1] + baseVertices[2] + baseVertices[3]);
+    float radius = glm::length(baseVertices[0] - centroid);
+
+    glm::mat4 viewProjection = projection * view;
+    glm::vec4 planes[6];
+    frustumPlanes(viewProjection, planes);
+
+    // Best first on the nearest point of each node's bounding sphere, by view-space depth (clip w is
+    // constant under the orthographic camera). A child's sphere lies inside its parent's, so no chunk
+    // comes out before a nearer one and only nodes in front of the last chunk taken are ever split.
+    struct Node {
+        glm::vec3 offset;
+        float scale;
+        float nearest; // view-space depth of the bounding sphere's nearest point
+        int depth;
+        uint64_t index;
+        bool operator<(const Node& other) const { return nearest > other.nearest; }
+    };
+    auto visit = [&](std::priority_queue<Node>& queue, const glm::vec3& offset, float scale, int nodeDepth, uint64_t index) {
+        glm::vec3 center = scale * centroid + offset;
+        if (outsideFrustum(planes, center, scale * radius)) return;
+        float depthInView = -(view * glm::vec4(center, 1.0f)).z;
+        queue.push({ offset, scale, depthInView - scale * radius, nodeDepth, index });
+    };
+
+    std::priority_queue<Node> queue;
+    visit(queue, glm::vec3(0.0f), 1.0f, 0, 0);
+    while (!queue.empty() && chunks.size() < maxCount) {
+        Node node = queue.top();
+        queue.pop();
+        if (node.depth == depth) {
+            chunks.push_back(node.index);
+            continue;
+        }
+
+        float half = 0.5f * node.scale;
+        for (int c = 0; c < 4; ++c) {
+            visit(queue, node.offset + half * baseVertices[c], half, node.depth + 1, node.index * 4 + c);
+        }
+    }
+}
+
+void generate(int level, glm::vec3* positions, glm::vec3* colors, ThreadPool& pool, BuildProgress* progress) {
+    checkLevel(level);
+
+    // aim for a few subtrees per thread so stealing can even out the load
+    size_t wanted = size_t(pool.size()) * 4;
+    if (progress && wanted < ProgressSlices) wanted = ProgressSlices;
+    int splitDepth = 0;
+    while (splitDepth < level && tetraCount(splitDepth) < wanted) {
+        ++splitDepth;
+    }
+    if (splitDepth == 0 || (pool.size() == 1 && !progress)) {
+        generate(level, positions, colors);
+        if (progress) progress->advance(tetraCount(level));
+        return;
+    }
+
+    // subtree roots at splitDepth, in depth-first order (children of node i sit at 4i..4i+3)
+    struct Node {
+        glm::vec3 corners[4];
+    };
+    std::vector<Node> roots(1);
+    for (int i = 0; i < 4; ++i) roots[0].corners[i] = baseVertices[i];
+
+    for (int depth = 0; depth < splitDepth; ++depth) {
+        std::vector<Node> next(roots.size() * 4);
+        for (size_t node = 0; node < roots.size(); ++node) {
+            glm::vec3 children[4][4];
+            splitTetra(roots[node].corners, children);
+            for (int c = 0; c < 4; ++c) {
+                for (int i = 0; i < 4; ++i) next[node * 4 + c].corners[i] = children[c][i];
+            }
+        }
+        roots.swap(next);
+    }
+
+    int subLevel = level - splitDepth;
+    size_t stride = vertexCount(subLevel);
+    pool.parallelFor(tetraCount(splitDepth), [&](size_t s) {
+        if (progress) progress->advance(0);
+        dividePyramid(roots[s].corners, subLevel, positions + s * stride, colors + s * stride);
+        if (progress) progress->advance(tetraCount(subLevel));
+    });
+}
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+class ThreadPool;
+struct BuildProgress;
+
+// CPU-side gasket geometry, independent of any GL context.
+// Every leaf tetra emits 4 triangles = 12 vertices, so level L holds exactly 12 * 4^L vertices.
+namespace GasketGeometry {
+    constexpr int MaxLevel = 20;
+    constexpr size_t VerticesPerTetra = 12;
+
+    extern const glm::vec3 baseVertices[4];
+    extern const glm::vec3 faceColors[4];
+
+    size_t tetraCount(int level);  // 4^level
+    size_t vertexCount(int level); // 12 * 4^level
+
+    // split a tetra into its 4 corner children (the central octahedron is dropped)
+    void splitTetra(const glm::vec3 (&parent)[4], glm::vec3 (&children)[4][4]);
+
+    // corners of subtree index at the given depth, numbered in dividePyramid order
+    // (the children of node i are 4i..4i+3)
+    void subtreeCorners(uint64_t index, int depth, glm::vec3 (&corners)[4]);
+
+    // write the 12 vertices of one tetra at positions/colors
+    void emitTetra(const glm::vec3 (&v)[4], glm::vec3* positions, glm::vec3* colors);
+
+    // Volume Subdivision, walked with an explicit stack instead of recursion.
+    // Leaves are written in the same depth-first order as the recursive algorithm,
+    // so leaf i always lands at vertex offset 12 * i. Caller provides vertexCount(level) slots.
+    // The last split is done in SoA batches by the widest LeafKernel the CPU supports.
+    void dividePyramid(const glm::vec3 (&corners)[4], int level, glm::vec3* positions, glm::vec3* colors);
+
+    // Generic form of the same walk: visit(leaf) for every leaf node, in dividePyramid order.
+    // split(parent, children) fills the Children children of a node, so a Node can carry extra
+    // per-corner data, and other subdivision rules (IfsEngine.h) reuse the walk.
+    template <int Children = 4, typename Node, typename Split, typename Visit>
+    void walkLeaves(const Node& root, int level, Split split, Visit visit);
+
+    // whole gasket starting from baseVertices
+    void generate(int level, glm::vec3* positions, glm::vec3* colors);
+
+    // Same output, split into 4^k subtrees that run on the pool.
+    // Subtree s owns the contiguous slice starting at s * vertexCount(level - k), so no locking is needed.
+    // With a progress, it advances one unit per leaf and the build stops between subtrees once cancelled.
+    void generate(int level, glm::vec3* positions, glm::vec3* colors, ThreadPool& pool, BuildProgress* progress = nullptr);
+
+    // Instanced form: every leaf is baseVertices * 2^-level + offset.
+    // Writes tetraCount(level) offsets in dividePyramid order.
+    void generateOffsets(int level, glm::vec3* offsets);
+
+    // Incremental forms: level + 1 from an already generated level, without walking down from the root.
+    // Leaf i of the parent becomes leaves 4i..4i+3, so the result equals a fresh generate(level + 1).
+    // parentPositions holds vertexCount(level) vertices as written by generate(); the corners of
+    // leaf i are read back from its first 4 vertices.
+    void refine(int level, const glm::vec3* parentPositions, glm::vec3* positions, glm::vec3* colors);
+    void refine(int level, const glm::vec3* parentPositions, glm::vec3* positions, glm::vec3* colors, ThreadPool& pool,
+        BuildProgress* progress = nullptr); // one unit per new leaf
+    void refineOffsets(int level, const glm::vec3* parentOffsets, glm::vec3* offsets);
+
+    // View-dependent cut through the tree. A node is refined only while its edge covers at least
+    // pixelThreshold pixels on screen and it is not below maxLevel; otherwise the whole node is drawn
+    // as one tetra (the hull of its subtree). Nodes outside the view frustum are dropped.
+    // Each selected node is written as (offset, scale): tetra = baseVertices * scale + offset.
+    struct LodView {
+        glm::mat4 view;
+        glm::mat4 projection;
+        float viewportHeight;
+        float pixelThreshold;
+        int maxLevel;
+    };
+    void selectLod(const LodView& lod, std::vector<glm::vec4>& nodes);
+
+    // the 6 clip planes of viewProjection, normalized, inside >= 0; and whether a sphere lies fully outside one
+    void frustumPlanes(const glm::mat4& viewProjection, glm::vec4 (&planes)[6]);
+    bool outsideFrustum(const glm::vec4 (&planes)[6], const glm::vec3& center, float radius);
+
+    // Subtrees at the given depth that intersect the view frustum, nearest first,
+    // at most maxCount of them. Each is written as its subtreeCorners() index.
+    void selectChunks(const glm::mat4& view, const glm::mat4& projection, int depth, size_t maxCount,
+        std::vector<uint64_t>& chunks);
+
+    // Indexed form: unique (position, face color) vertices plus a triangle list.
+    // Shared corners are found through their exact integer lattice coordinates, and the
+    // indices are reordered for the post-transform vertex cache.
+    // Progress: one unit per leaf while walking, then one per triangle while reordering (5 per leaf in all).
+    constexpr int IndexedMaxLevel = 12;
+    void generateIndexed(int level, std::pmr::vector<glm::vec3>& positions, std::pmr::vector<glm::vec3>& colors,
+        std::vector<uint32_t>& indices, BuildProgress* progress = nullptr);
+}
+
+template <int Children, typename Node, typename Split, typename Visit>
+void GasketGeometry::walkLeaves(const Node& root, int level, Split split, Visit visit) {
+    if (level == 0) {
+        visit(root);
+        return;
+    }
+
+    struct Frame {
+        Node children[Children];
+        int next;
+    };
+    Frame stack[MaxLevel];
+
+    int top = 0;
+    split(root, stack[0].children);
+    stack[0].next = 0;
+
+    while (top >= 0) {
+        Frame& frame = stack[top];
+        if (frame.next == Children) {
+            --top;
+            continue;
+        }
+
+        const Node& node = frame.children[frame.next++];
+        if (top == level - 1) {
+            visit(node);
+            continue;
+        }
+
+        split(node, stack[top + 1].children);
+        stack[top + 1].next = 0;
+        ++top;
+    }
+}
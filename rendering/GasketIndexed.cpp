@@ -0,0 +1,142 @@
+#include "GasketGeometry.h"
+#include "BuildProgress.h"
+#include "LatticeGeometry.h"
+#include "VertexCache.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace GasketGeometry {
+
+namespace {
+    // The float corners, for the same positions as Triangles, walked alongside their exact
+    // lattice coordinates (LatticeGeometry.h), which name each corner for the dedup.
+    struct LatticeTetra {
+        glm::vec3 p[4];
+        LatticeGeometry::Tetra lattice;
+    };
+
+    void splitLattice(const LatticeTetra& parent, LatticeTetra (&children)[4]) {
+        glm::vec3 floats[4][4];
+        splitTetra(parent.p, floats);
+        LatticeGeometry::Tetra lattice[4];
+        LatticeGeometry::split(parent.lattice, lattice);
+
+        for (int c = 0; c < 4; ++c) {
+            for (int i = 0; i < 4; ++i) children[c].p[i] = floats[c][i];
+            children[c].lattice = lattice[c];
+        }
+    }
+
+    // corner and face color of the 12 vertices of a leaf, in emitTetra order
+    constexpr int LeafCorner[12] = { 0, 1, 2, 3, 2, 1, 0, 3, 1, 0, 2, 3 };
+    constexpr int LeafColor[12] = { 0, 0, 0, 3, 3, 3, 2, 2, 2, 1, 1, 1 };
+
+    // open-addressing map from packed lattice key to vertex index
+    class LatticeMap {
+    public:
+        explicit LatticeMap(size_t expected) {
+            size_t capacity = 16;
+            while (capacity < expected * 2) capacity <<= 1;
+            Keys.assign(capacity, Empty);
+            Values.resize(capacity);
+            Mask = capacity - 1;
+        }
+
+        // index stored for key, or insert next and return it
+        uint32_t findOrInsert(uint64_t key, uint32_t next, bool& inserted) {
+            size_t slot = hash(key) & Mask;
+            while (true) {
+                if (Keys[slot] == key) {
+                    inserted = false;
+                    return Values[slot];
+                }
+                if (Keys[slot] == Empty) {
+                    Keys[slot] = key;
+                    Values[slot] = next;
+                    inserted = true;
+                    return next;
+                }
+                slot = (slot + 1) & Mask;
+            }
+        }
+
+    private:
+        static constexpr uint64_t Empty = ~uint64_t(0);
+
+        static uint64_t hash(uint64_t x) {
+            // splitmix64 finalizer
+            x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+            x ^= x >> 27; x *= 0x94d049bb133111ebull;
+            x ^= x >> 31;
+            return x;
+        }
+
+        std::vector<uint64_t> Keys;
+        std::vector<uint32_t> Values;
+        size_t Mask = 0;
+    };
+}
+
+void generateIndexed(int level, std::pmr::vector<glm::vec3>& positions, std::pmr::vector<glm::vec3>& colors,
+    std::vector<uint32_t>& indices, BuildProgress* progress) {
+    if (level < 0 || level > IndexedMaxLevel) {
+        throw std::invalid_argument("Indexed subdivision level out of range: " + std::to_string(level));
+    }
+
+    // each coordinate needs level + 1 bits, plus 2 bits of face color
+    const int bits = level + 1;
+
+    LatticeTetra root;
+    for (int i = 0; i < 4; ++i) root.p[i] = baseVertices[i];
+    root.lattice = LatticeGeometry::root(level);
+
+    // a shared corner keeps 2 of its 3 face colors in common with its neighbour: ~8 unique vertices per leaf
+    size_t leaves = tetraCount(level);
+    positions.clear();
+    colors.clear();
+    positions.reserve(leaves * 8 + 4);
+    colors.reserve(leaves * 8 + 4);
+    indices.resize(leaves * VerticesPerTetra);
+
+    LatticeMap map(leaves * 8 + 4);
+    uint32_t* out = indices.data();
+
+    constexpr size_t ProgressStep = 4096;
+    size_t visited = 0;
+    walkLeaves(root, level, splitLattice, [&](const LatticeTetra& leaf) {
+        if (progress && ++visited % ProgressStep == 0) progress->advance(ProgressStep);
+
+        for (int v = 0; v < 12; ++v) {
+            const uint32_t* k = leaf.lattice.k[LeafCorner[v]];
+            uint64_t key = (uint64_t(k[0]) << (2 * bits + 2)) | (uint64_t(k[1]) << (bits + 2))
+                | (uint64_t(k[2]) << 2) | uint64_t(LeafColor[v]);
+
+            bool inserted;
+            uint32_t index = map.findOrInsert(key, static_cast<uint32_t>(positions.size()), inserted);
+            if (inserted) {
+                positions.push_back(leaf.p[LeafCorner[v]]);
+                colors.push_back(faceColors[LeafColor[v]]);
+            }
+            *out++ = index;
+        }
+    });
+    if (progress) progress->advance(visited % ProgressStep);
+
+    // triangle order for the post-transform cache, then vertex order for fetch locality
+    VertexCache::optimize(indices, positions.size(), progress);
+
+    std::vector<uint32_t> remap;
+    VertexCache::orderByFirstUse(indices, positions.size(), remap);
+
+    std::pmr::vector<glm::vec3> sortedPositions(positions.size(), positions.get_allocator());
+    std::pmr::vector<glm::vec3> sortedColors(colors.size(), colors.get_allocator());
+    for (size_t v = 0; v < remap.size(); ++v) {
+        sortedPositions[remap[v]] = positions[v];
+        sortedColors[remap[v]] = colors[v];
+    }
+    positions.swap(sortedPositions);
+    colors.swap(sortedColors);
+}
+
+}
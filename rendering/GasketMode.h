@@ -0,0 +1,38 @@
+#pragma once
+
+// how TetraGasket stores and draws the geometry
+enum class GasketMode {
+    Triangles, // 12 unshared vertices per leaf, glDrawArrays
+    Indexed,   // shared vertices + element buffer, glDrawElements
+    Instanced, // one base tetra + one offset per leaf, glDrawArraysInstanced
+    Procedural, // no vertex data: gasket.vert rebuilds each leaf from gl_InstanceID
+    Lod,       // view-dependent cut through the tree, re-selected when the view changes
+    Chunked,   // Triangles in fixed-size subtree chunks, streamed into a GPU budget, glMultiDrawArrays
+    Count
+};
+
+inline const char* gasketModeName(GasketMode mode) {
+    switch (mode) {
+    case GasketMode::Triangles: return "Triangles";
+    case GasketMode::Indexed: return "Indexed";
+    case GasketMode::Instanced: return "Instanced";
+    case GasketMode::Procedural: return "Procedural";
+    case GasketMode::Lod: return "Screen-space LOD";
+    case GasketMode::Chunked: return "Chunked (streamed)";
+    default: return "?";
+    }
+}
+
+// deepest level each mode is offered at. Triangles / Indexed keep the whole mesh in one buffer
+// (level 13 is 19 GB, 14 overflows a GLsizei count), Instanced / Procedural count leaves in a
+// signed gl_InstanceID, Chunked only keeps what fits its budget; LOD ignores the level.
+inline int gasketModeMaxLevel(GasketMode mode) {
+    switch (mode) {
+    case GasketMode::Triangles: return 12;
+    case GasketMode::Indexed: return 12;
+    case GasketMode::Instanced: return 15;
+    case GasketMode::Procedural: return 15;
+    case GasketMode::Chunked: return 20;
+    default: return 0;
+    }
+}
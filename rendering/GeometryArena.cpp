@@ -0,0 +1,174 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace {
+    constexpr size_t BlockAlignment = 64; // a cache line, more than any vertex type needs
+    constexpr size_t PageBytes = 4096;
+
+    size_t roundUp(size_t value, size_t step) {
+        return (value + step - 1) / step * step;
+    }
+
+    void raise(std::atomic<size_t>& peak, size_t value) {
+        size_t seen = peak.load(std::memory_order_relaxed);
+        while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+    }
+}
+
+// --- ArenaPool ---
+
+ArenaPool::~ArenaPool() {
+    trim();
+}
+
+ArenaPool& ArenaPool::shared() {
+    static ArenaPool pool;
+    return pool;
+}
+
+ArenaStats ArenaPool::stats() const {
+    ArenaStats stats;
+    stats.Reserved = Reserved.load(std::memory_order_relaxed);
+    stats.Used = Used.load(std::memory_order_relaxed);
+    stats.Peak = Peak.load(std::memory_order_relaxed);
+    stats.Allocations = Allocations.load(std::memory_order_relaxed);
+    stats.HeapBlocks = HeapBlocks.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void ArenaPool::resetPeak() {
+    Peak.store(Reserved.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void ArenaPool::setRetained(size_t bytes) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Retained = bytes;
+    dropOverRetained();
+}
+
+void ArenaPool::trim() {
+    std::lock_guard<std::mutex> lock(Mutex);
+    for (const Block& block : Free) {
+        ::operator delete(block.Data, std::align_val_t(BlockAlignment));
+        Reserved.fetch_sub(block.Bytes, std::memory_order_relaxed);
+    }
+    Free.clear();
+    FreeBytes = 0;
+}
+
+ArenaPool::Block ArenaPool::acquire(size_t bytes) {
+    bytes = roundUp(bytes, PageBytes);
+    {
+        // the smallest kept block that fits, unless it would waste more than it holds
+        std::lock_guard<std::mutex> lock(Mutex);
+        size_t best = Free.size();
+        for (size_t i = 0; i < Free.size(); ++i) {
+            if (Free[i].Bytes >= bytes && Free[i].Bytes <= 2 * bytes
+                && (best == Free.size() || Free[i].Bytes < Free[best].Bytes)) {
+                best = i;
+            }
+        }
+        if (best != Free.size()) {
+            Block block = Free[best];
+            Free.erase(Free.begin() + best);
+            FreeBytes -= block.Bytes;
+            return block;
+        }
+    }
+
+    Block block{ static_cast<char*>(::operator new(bytes, std::align_val_t(BlockAlignment))), bytes };
+    HeapBlocks.fetch_add(1, std::memory_order_relaxed);
+    raise(Peak, Reserved.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+    return block;
+}
+
+void ArenaPool::release(Block block) {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Free.push_back(block);
+    FreeBytes += block.Bytes;
+    dropOverRetained();
+}
+
+void ArenaPool::dropOverRetained() {
+    size_t dropped = 0;
+    while (dropped < Free.size() && FreeBytes > Retained) {
+        const Block& block = Free[dropped++];
+        ::operator delete(block.Data, std::align_val_t(BlockAlignment));
+        FreeBytes -= block.Bytes;
+        Reserved.fetch_sub(block.Bytes, std::memory_order_relaxed);
+    }
+    Free.erase(Free.begin(), Free.begin() + dropped);
+}
+
+// --- GeometryArena ---
+
+GeometryArena::~GeometryArena() {
+    for (const Block& block : Blocks) Pool.release(block.Memory);
+    Pool.Used.fetch_sub(Used, std::memory_order_relaxed);
+}
+
+size_t GeometryArena::reserved() const {
+    size_t total = 0;
+    for (const Block& block : Blocks) total += block.Memory.Bytes;
+    return total;
+}
+
+void* GeometryArena::bump(Block& block, size_t bytes, size_t alignment) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.Memory.Data);
+    size_t offset = roundUp(base + block.Next, alignment) - base;
+    if (offset > block.Memory.Bytes || bytes > block.Memory.Bytes - offset) return nullptr;
+    block.Next = offset + bytes;
+    ++block.Live;
+    return block.Memory.Data + offset;
+}
+
+void* GeometryArena::do_allocate(size_t bytes, size_t alignment) {
+    bytes = std::max<size_t>(bytes, 1);
+    void* pointer = Current != NoBlock ? bump(Blocks[Current], bytes, alignment) : nullptr;
+    if (!pointer) {
+        // over alignment the block gives by itself, it may have to skip up to alignment bytes
+        size_t needed = bytes + (alignment > BlockAlignment ? alignment : 0);
+        if (needed > NextBlockBytes / 2) {
+            // large: a block of its own, freed as soon as this allocation is
+            Blocks.push_back({ Pool.acquire(needed) });
+        }
+        else {
+            Blocks.push_back({ Pool.acquire(NextBlockBytes) });
+            Current = Blocks.size() - 1;
+            NextBlockBytes = std::min(2 * NextBlockBytes, MaxBlockBytes);
+        }
+        pointer = bump(Blocks.back(), bytes, alignment);
+    }
+
+    Used += bytes;
+    Pool.Used.fetch_add(bytes, std::memory_order_relaxed);
+    Pool.Allocations.fetch_add(1, std::memory_order_relaxed);
+    return pointer;
+}
+
+void GeometryArena::do_deallocate(void* pointer, size_t bytes, size_t) {
+    bytes = std::max<size_t>(bytes, 1);
+    Used -= bytes;
+    Pool.Used.fetch_sub(bytes, std::memory_order_relaxed);
+
+    // newest first: vectors that grow free the allocation just before the one they grew into
+    const char* address = static_cast<const char*>(pointer);
+    for (size_t i = Blocks.size(); i-- > 0;) {
+        Block& block = Blocks[i];
+        if (address < block.Memory.Data || address >= block.Memory.Data + block.Memory.Bytes) continue;
+        if (--block.Live > 0) return;
+
+        if (i == Current) {
+            block.Next = 0; // empty again, bumped from the start
+        }
+        else {
+            Pool.release(block.Memory);
+            Blocks.erase(Blocks.begin() + i);
+            if (Current != NoBlock && Current > i) --Current;
+        }
+        return;
+    }
+}
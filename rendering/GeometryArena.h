@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+// Memory for the big per-level vectors: positions, colors, offsets and packed vertices.
+// Each GasketLevel allocates them from its own GeometryArena, a std::pmr::memory_resource that bumps
+// through blocks taken from one process-wide ArenaPool. The pool keeps returned blocks for the next
+// build instead of handing them to the heap. Switching levels back and forth then reuses memory that
+// is already mapped, and does not churn the heap.
+//
+// The arena is not strictly monotonic, unlike std::pmr::monotonic_buffer_resource: it counts the live
+// allocations of each block, and a block goes back to the pool as soon as nothing in it is live.
+// A level frees the bulk of what it allocated long before it is dropped: the packed copy once it is
+// uploaded, the float streams once a persistent-mapped level is packed, and the old buffers of
+// vectors that grew. A monotonic resource would keep all of that reserved until the level is evicted.
+
+// Counters of an ArenaPool, for the performance HUD and GeometryBench
+struct ArenaStats {
+    size_t Reserved = 0; // bytes of blocks taken from the heap: lent to arenas or kept for reuse
+    size_t Used = 0; // bytes handed out by the arenas and not yet freed
+    size_t Peak = 0; // highest Reserved since the last resetPeak()
+    size_t Allocations = 0; // allocations served by the arenas
+    size_t HeapBlocks = 0; // blocks taken from the heap; a reused block does not count
+};
+
+class ArenaPool {
+public:
+    static constexpr size_t DefaultRetained = size_t(256) << 20;
+
+    ArenaPool() = default;
+    ~ArenaPool();
+
+    ArenaPool(const ArenaPool&) = delete;
+    ArenaPool& operator=(const ArenaPool&) = delete;
+
+    static ArenaPool& shared(); // the pool of every GasketLevel
+
+    ArenaStats stats() const;
+    void resetPeak();
+
+    // bytes of returned blocks kept for reuse; the oldest ones beyond this go back to the heap
+    void setRetained(size_t bytes);
+    size_t retained() const { return Retained; }
+    void trim(); // every kept block back to the heap
+
+private:
+    friend class GeometryArena;
+
+    struct Block {
+        char* Data;
+        size_t Bytes;
+    };
+
+    // a kept block of at least bytes (and not much larger), or a new one from the heap
+    Block acquire(size_t bytes);
+    void release(Block block);
+    void dropOverRetained(); // Mutex held
+
+    mutable std::mutex Mutex;
+    std::vector<Block> Free; // oldest first
+    size_t FreeBytes = 0;
+    size_t Retained = DefaultRetained;
+
+    std::atomic<size_t> Reserved{ 0 };
+    std::atomic<size_t> Used{ 0 };
+    std::atomic<size_t> Peak{ 0 };
+    std::atomic<size_t> Allocations{ 0 };
+    std::atomic<size_t> HeapBlocks{ 0 };
+};
+
+// Not thread-safe: one thread allocates at a time, as in a level build. Freeing single allocations
+// only returns memory once a whole block is free; requests larger than a small block get a block
+// of their own, so a level's big vectors go back to the pool as soon as they are freed.
+class GeometryArena : public std::pmr::memory_resource {
+public:
+    explicit GeometryArena(ArenaPool& pool = ArenaPool::shared()) : Pool(pool) {}
+    ~GeometryArena() override;
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    size_t reserved() const; // bytes of the blocks held
+    size_t used() const { return Used; }
+
+private:
+    // small requests share blocks that double from 64 KB up to 4 MB
+    static constexpr size_t FirstBlockBytes = size_t(64) << 10;
+    static constexpr size_t MaxBlockBytes = size_t(4) << 20;
+
+    struct Block {
+        ArenaPool::Block Memory;
+        size_t Next = 0; // bump offset
+        size_t Live = 0; // allocations not yet freed
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    void* bump(Block& block, size_t bytes, size_t alignment); // nullptr when it does not fit
+
+    static constexpr size_t NoBlock = size_t(-1);
+
+    ArenaPool& Pool;
+    std::vector<Block> Blocks;
+    size_t Current = NoBlock; // index of the shared block small requests bump through
+    size_t NextBlockBytes = FirstBlockBytes;
+    size_t Used = 0;
+};
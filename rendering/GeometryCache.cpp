@@ -0,0 +1,140 @@
+#include "GeometryCache.h"
+#include "ChunkedGeometry.h"
+#include "../core/Trace.h"
+
+void GasketLevel::createBuffers() {
+    TRACE_ZONE("GasketLevel::createBuffers");
+    if (VBO_Position != 0) return;
+
+    glCreateBuffers(1, &VBO_Position);
+    glCreateBuffers(1, &VBO_Color);
+    glCreateBuffers(1, &VBO_Offset);
+    glCreateBuffers(1, &EBO);
+}
+
+GasketLevel::~GasketLevel() {
+    if (EBO != 0) glDeleteBuffers(1, &EBO);
+    if (VBO_Offset != 0) glDeleteBuffers(1, &VBO_Offset);
+    if (VBO_Color != 0) glDeleteBuffers(1, &VBO_Color);
+    if (VBO_Position != 0) glDeleteBuffers(1, &VBO_Position);
+}
+
+GLuint GasketLevel::buffer(int stream) const {
+    switch (stream) {
+    case PositionStream: return VBO_Position;
+    case ColorStream: return VBO_Color;
+    case OffsetStream: return VBO_Offset;
+    default: return EBO;
+    }
+}
+
+void GasketLevel::streamData(int stream, const void*& data, size_t& bytes) const {
+    data = nullptr;
+    bytes = 0;
+    if (FileStreams[stream]) {
+        data = FileStreams[stream];
+        bytes = FileStreamBytes[stream];
+        return;
+    }
+
+    switch (stream) {
+    case PositionStream:
+        if (!Packed.empty()) {
+            data = Packed.data();
+            bytes = Packed.size();
+        }
+        else {
+            data = Positions.data();
+            bytes = Positions.size() * sizeof(glm::vec3);
+        }
+        break;
+    case ColorStream:
+        // compact formats carry the color inside the position stream
+        if (Format == VertexFormat::Float32) {
+            data = Colors.data();
+            bytes = Colors.size() * sizeof(glm::vec3);
+        }
+        break;
+    case OffsetStream:
+        data = Offsets.data();
+        bytes = Offsets.size() * sizeof(glm::vec3);
+        break;
+    default:
+        data = Indices.data();
+        bytes = Indices.size() * sizeof(uint32_t);
+        break;
+    }
+    if (bytes == 0) data = nullptr;
+}
+
+void* GasketLevel::mapStorage(int stream, size_t bytes) {
+    // coherent: writes from any thread are seen by draws issued after the build has finished
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glNamedBufferStorage(buffer(stream), bytes, nullptr, flags);
+    BufferBytes[stream] = bytes;
+    return glMapNamedBufferRange(buffer(stream), 0, bytes, flags);
+}
+
+void GasketLevel::bufferData(int stream, size_t bytes, const void* data, GLenum usage) {
+    glNamedBufferData(buffer(stream), bytes, data, usage);
+    BufferBytes[stream] = bytes;
+}
+
+size_t GasketLevel::cpuBytes() const {
+    return Positions.capacity() * sizeof(glm::vec3) + Colors.capacity() * sizeof(glm::vec3)
+        + Indices.capacity() * sizeof(uint32_t) + Offsets.capacity() * sizeof(glm::vec3) + Packed.capacity()
+        + Meshlets.capacity() * sizeof(Meshlet);
+}
+
+size_t GasketLevel::gpuBytes() const {
+    // summed from the recorded sizes: trim() and the HUD ask every frame, a GL query would sync
+    size_t total = 0;
+    for (size_t bytes : BufferBytes) total += bytes;
+    if (Chunks) total += Chunks->gpuBytes();
+    return total;
+}
+
+GasketLevel* GeometryCache::find(Fractal shape, GasketMode mode, VertexFormat format, int level) {
+    for (size_t i = 0; i < Levels.size(); ++i) {
+        GasketLevel* entry = Levels[i].get();
+        if (entry->Shape == shape && entry->Mode == mode && entry->Format == format && entry->Level == level) {
+            // move to the back: most recently used
+            std::unique_ptr<GasketLevel> used = std::move(Levels[i]);
+            Levels.erase(Levels.begin() + i);
+            Levels.push_back(std::move(used));
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+GasketLevel* GeometryCache::findLevel(Fractal shape, GasketMode mode, int level) {
+    for (const std::unique_ptr<GasketLevel>& entry : Levels) {
+        if (entry->Shape == shape && entry->Mode == mode && entry->Level == level) return entry.get();
+    }
+    return nullptr;
+}
+
+GasketLevel* GeometryCache::insert(std::unique_ptr<GasketLevel> entry) {
+    Levels.push_back(std::move(entry));
+    Newest = Levels.back().get();
+    return Levels.back().get();
+}
+
+void GeometryCache::trim(const GasketLevel* keep) {
+    size_t total = bytes();
+    for (size_t i = 0; i < Levels.size() && total > Budget;) {
+        if (Levels[i].get() == keep || Levels[i].get() == Newest || Levels[i]->Pinned) {
+            ++i;
+            continue;
+        }
+        total -= Levels[i]->bytes();
+        Levels.erase(Levels.begin() + i);
+    }
+}
+
+size_t GeometryCache::bytes() const {
+    size_t total = 0;
+    for (const std::unique_ptr<GasketLevel>& entry : Levels) total += entry->bytes();
+    return total;
+}
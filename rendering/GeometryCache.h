@@ -0,0 +1,127 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "Fractal.h"
+#include "GasketMode.h"
+#include "GeometryArena.h"
+#include "Meshlets.h"
+#include "VertexFormat.h"
+#include "../core/MappedFile.h"
+
+class ChunkedGeometry;
+
+// Everything needed to draw one generated (shape, mode, format, level) again: its GL buffers and CPU copies.
+// The CPU side can be filled on any thread; createBuffers() and the destructor need the GL context
+// once buffers exist.
+struct GasketLevel {
+    GasketLevel() = default;
+    ~GasketLevel();
+
+    GasketLevel(const GasketLevel&) = delete;
+    GasketLevel& operator=(const GasketLevel&) = delete;
+
+    // the GPU streams, in buffer order
+    enum Stream { PositionStream, ColorStream, OffsetStream, IndexStream, StreamCount };
+
+    Fractal Shape = Fractal::Tetrahedron;
+    GasketMode Mode = GasketMode::Triangles;
+    VertexFormat Format = VertexFormat::Float32;
+    int Level = 0;
+
+    GLuint VBO_Position = 0;
+    GLuint VBO_Color = 0;
+    GLuint VBO_Offset = 0; // Instanced: vec3 offset, LOD: vec4 (offset, scale)
+    GLuint EBO = 0;
+
+    // Persistent-mapped storage the build writes into directly (UploadPath::Mapped),
+    // nullptr for buffers filled by copy. Such streams keep no CPU vector.
+    void* MappedPosition = nullptr;
+    void* MappedColor = nullptr;
+    void* MappedOffset = nullptr;
+
+    // the big streams live in the level's arena, whose blocks are reused by later builds once it is dropped
+    GeometryArena Arena;
+    std::pmr::vector<glm::vec3> Positions{ &Arena }; // always Float32, also the source for refining to the next level
+    std::pmr::vector<glm::vec3> Colors{ &Arena };
+    std::vector<uint32_t> Indices; // Indexed mode only
+    std::pmr::vector<glm::vec3> Offsets{ &Arena }; // Instanced mode only
+    std::pmr::vector<uint8_t> Packed{ &Arena }; // compact vertices waiting for upload, non-Float32 formats only
+    std::vector<Meshlet> Meshlets; // Triangles mode only, culled per view instead of drawing every vertex
+
+    std::unique_ptr<ChunkedGeometry> Chunks; // Chunked mode only, created on the GL thread when first drawn
+
+    // streams uploaded from read-only memory instead of the vectors: the mapping of a level read
+    // from the on-disk cache (File), or the compiled-in tables of BakedGasket.h
+    MappedFile File;
+    const uint8_t* FileStreams[StreamCount] = {};
+    size_t FileStreamBytes[StreamCount] = {};
+
+    size_t BufferBytes[StreamCount] = {}; // storage given to each buffer so far
+
+    size_t VertexCount = 0;
+    size_t IndexCount = 0;
+    size_t InstanceCount = 0;
+    float Scale = 1.0f; // base tetra scale, 2^-level when instanced
+    float LatticeScale = 0.0f; // 2^-level for Lattice16 vertices, otherwise 0
+    int ProceduralLevel = -1; // level decoded by gasket.vert, -1 = read vertex attributes
+    bool Pinned = false; // read by a background build, never evicted
+
+    void createBuffers(); // no-op once created
+    GLuint buffer(int stream) const;
+
+    // CPU bytes of a stream exactly as uploaded: from the loaded file, the packed vertices or the
+    // float vectors. nullptr / 0 when the stream is unused or only lives in mapped storage.
+    void streamData(int stream, const void*& data, size_t& bytes) const;
+
+    // immutable storage for a stream's buffer, mapped for writing for the buffer's whole life
+    void* mapStorage(int stream, size_t bytes);
+
+    // (re)allocates a stream's buffer with glNamedBufferData; data may be nullptr
+    void bufferData(int stream, size_t bytes, const void* data, GLenum usage);
+
+    size_t cpuBytes() const;
+    size_t gpuBytes() const; // sizes recorded by mapStorage() / bufferData(), no GL query
+    size_t bytes() const { return cpuBytes() + gpuBytes(); }
+};
+
+// Recently generated levels, so switching back to one is a rebind instead of a rebuild.
+// Least recently used levels are dropped once the total (CPU + GPU) goes over the budget.
+// The level inserted last is kept too, so a level larger than the whole budget (10-12 at the
+// default) survives switching away from it until the next one is built.
+class GeometryCache {
+public:
+    static constexpr size_t DefaultBudget = size_t(512) << 20;
+
+    // cached entry, marked as most recently used; nullptr if not cached
+    GasketLevel* find(Fractal shape, GasketMode mode, VertexFormat format, int level);
+
+    // any cached entry of this shape and mode at exactly this level, whatever its format (refinement source)
+    GasketLevel* findLevel(Fractal shape, GasketMode mode, int level);
+
+    GasketLevel* insert(std::unique_ptr<GasketLevel> entry);
+
+    // evict least recently used entries until within budget; keep, pinned and the newest entry are never evicted
+    void trim(const GasketLevel* keep);
+
+    void setBudget(size_t bytes) { Budget = bytes; }
+    size_t budget() const { return Budget; }
+    size_t bytes() const;
+    size_t size() const { return Levels.size(); }
+
+    void clear() {
+        Levels.clear();
+        Newest = nullptr;
+    }
+
+private:
+    std::vector<std::unique_ptr<GasketLevel>> Levels; // most recently used last
+    size_t Budget = DefaultBudget;
+    const GasketLevel* Newest = nullptr; // last inserted
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BuildProgress.h"
+#include "GasketGeometry.h"
+#include "../core/ThreadPool.h"
+
+// Iterated function system engine: the dividePyramid walk with the subdivision rule as a template
+// parameter, so each rule gets its own fully inlined walk and no call goes through a pointer.
+// A Rule is a struct of statics (see IfsRules.h):
+//   using Node = ...;                 state of one node (corners, or offset + scale)
+//   Children, VerticesPerLeaf, MaxLevel
+//   static Node root();
+//   static void split(const Node& parent, Node (&children)[Children]);
+//   static void emit(const Node& leaf, glm::vec3* positions, glm::vec3* colors); // VerticesPerLeaf vertices
+// Leaves come out in depth-first order, child 0 first, so leaf i always lands at VerticesPerLeaf * i.
+namespace Ifs {
+    template <typename Rule>
+    size_t leafCount(int level) {
+        if (level < 0 || level > Rule::MaxLevel) {
+            throw std::invalid_argument("Fractal level out of range: " + std::to_string(level));
+        }
+        size_t count = 1;
+        for (int i = 0; i < level; ++i) count *= Rule::Children;
+        return count;
+    }
+
+    template <typename Rule>
+    size_t vertexCount(int level) {
+        return leafCount<Rule>(level) * Rule::VerticesPerLeaf;
+    }
+
+    // the subtree below root, level levels deep; caller provides vertexCount<Rule>(level) slots
+    template <typename Rule>
+    void generate(const typename Rule::Node& root, int level, glm::vec3* positions, glm::vec3* colors) {
+        using Node = typename Rule::Node;
+        GasketGeometry::walkLeaves<Rule::Children>(root, level,
+            [](const Node& parent, Node (&children)[Rule::Children]) { Rule::split(parent, children); },
+            [&](const Node& leaf) {
+                Rule::emit(leaf, positions, colors);
+                positions += Rule::VerticesPerLeaf;
+                colors += Rule::VerticesPerLeaf;
+            });
+    }
+
+    template <typename Rule>
+    void generate(int level, glm::vec3* positions, glm::vec3* colors) {
+        leafCount<Rule>(level);
+        generate<Rule>(Rule::root(), level, positions, colors);
+    }
+
+    // Same output from subtrees on the pool, each owning a contiguous slice, like
+    // GasketGeometry::generate. Progress advances one unit per leaf.
+    template <typename Rule>
+    void generate(int level, glm::vec3* positions, glm::vec3* colors, ThreadPool& pool, BuildProgress* progress = nullptr) {
+        using Node = typename Rule::Node;
+        leafCount<Rule>(level);
+
+        size_t wanted = size_t(pool.size()) * 4;
+        if (progress && wanted < 256) wanted = 256;
+        int splitDepth = 0;
+        while (splitDepth < level && leafCount<Rule>(splitDepth) < wanted) {
+            ++splitDepth;
+        }
+
+        // subtree roots in depth-first order: the children of node i sit at Children * i + c
+        std::vector<Node> roots(1, Rule::root());
+        for (int depth = 0; depth < splitDepth; ++depth) {
+            std::vector<Node> next(roots.size() * Rule::Children);
+            for (size_t node = 0; node < roots.size(); ++node) {
+                Node children[Rule::Children];
+                Rule::split(roots[node], children);
+                for (int c = 0; c < Rule::Children; ++c) next[node * Rule::Children + c] = children[c];
+            }
+            roots.swap(next);
+        }
+
+        int subLevel = level - splitDepth;
+        size_t stride = vertexCount<Rule>(subLevel);
+        pool.parallelFor(roots.size(), [&](size_t s) {
+            if (progress) progress->advance(0);
+            generate<Rule>(roots[s], subLevel, positions + s * stride, colors + s * stride);
+            if (progress) progress->advance(leafCount<Rule>(subLevel));
+        });
+    }
+}
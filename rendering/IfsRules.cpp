@@ -0,0 +1,82 @@
+#include "IfsRules.h"
+#include "BuildProgress.h"
+#include "../core/ThreadPool.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace Ifs {
+
+const glm::vec3 TriangleRule::Corners[3] = {
+    glm::vec3(-0.5f, -std::sqrt(3.0f) / 6.0f, 0.0f),
+    glm::vec3(0.5f, -std::sqrt(3.0f) / 6.0f, 0.0f),
+    glm::vec3(0.0f, std::sqrt(3.0f) / 3.0f, 0.0f)
+};
+
+const glm::vec3 OctahedronRule::Corners[6] = {
+    glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(-0.5f, 0.0f, 0.0f),
+    glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, -0.5f, 0.0f),
+    glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.0f, 0.0f, -0.5f)
+};
+
+namespace {
+    template <typename Rule>
+    void generateWith(int level, glm::vec3* positions, glm::vec3* colors, ThreadPool* pool, BuildProgress* progress) {
+        if (pool) {
+            generate<Rule>(level, positions, colors, *pool, progress);
+        }
+        else {
+            generate<Rule>(level, positions, colors);
+            if (progress) progress->advance(leafCount<Rule>(level));
+        }
+    }
+}
+
+size_t leafCount(Fractal fractal, int level) {
+    switch (fractal) {
+    case Fractal::Tetrahedron: return leafCount<TetrahedronRule>(level);
+    case Fractal::Triangle: return leafCount<TriangleRule>(level);
+    case Fractal::Menger: return leafCount<MengerRule>(level);
+    case Fractal::Octahedron: return leafCount<OctahedronRule>(level);
+    default: throw std::invalid_argument("Unknown fractal: " + std::to_string(static_cast<int>(fractal)));
+    }
+}
+
+size_t vertexCount(Fractal fractal, int level) {
+    switch (fractal) {
+    case Fractal::Tetrahedron: return vertexCount<TetrahedronRule>(level);
+    case Fractal::Triangle: return vertexCount<TriangleRule>(level);
+    case Fractal::Menger: return vertexCount<MengerRule>(level);
+    case Fractal::Octahedron: return vertexCount<OctahedronRule>(level);
+    default: throw std::invalid_argument("Unknown fractal: " + std::to_string(static_cast<int>(fractal)));
+    }
+}
+
+void generate(Fractal fractal, int level, glm::vec3* positions, glm::vec3* colors, ThreadPool* pool,
+    BuildProgress* progress) {
+    switch (fractal) {
+    case Fractal::Tetrahedron:
+        if (pool) {
+            GasketGeometry::generate(level, positions, colors, *pool, progress);
+        }
+        else {
+            GasketGeometry::generate(level, positions, colors);
+            if (progress) progress->advance(GasketGeometry::tetraCount(level));
+        }
+        break;
+    case Fractal::Triangle:
+        generateWith<TriangleRule>(level, positions, colors, pool, progress);
+        break;
+    case Fractal::Menger:
+        generateWith<MengerRule>(level, positions, colors, pool, progress);
+        break;
+    case Fractal::Octahedron:
+        generateWith<OctahedronRule>(level, positions, colors, pool, progress);
+        break;
+    default:
+        throw std::invalid_argument("Unknown fractal: " + std::to_string(static_cast<int>(fractal)));
+    }
+}
+
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <initializer_list>
+
+#include "Fractal.h"
+#include "GasketGeometry.h"
+#include "IfsEngine.h"
+
+class ThreadPool;
+struct BuildProgress;
+
+// The subdivision rules for IfsEngine.h. All shapes are centered near the origin with an edge of
+// about 1, like the base tetra, and use faceColors so they look at home next to the gasket.
+namespace Ifs {
+    // The gasket itself, through the generic walk: bit-identical to dividePyramid, but one leaf at a
+    // time instead of in LeafKernel batches. Kept as the reference the other rules are measured against.
+    struct TetrahedronRule {
+        struct Node {
+            glm::vec3 v[4];
+        };
+        static constexpr int Children = 4;
+        static constexpr int VerticesPerLeaf = static_cast<int>(GasketGeometry::VerticesPerTetra);
+        static constexpr int MaxLevel = GasketGeometry::MaxLevel;
+
+        static Node root() {
+            Node node;
+            for (int i = 0; i < 4; ++i) node.v[i] = GasketGeometry::baseVertices[i];
+            return node;
+        }
+
+        static void split(const Node& parent, Node (&children)[Children]) {
+            glm::vec3 corners[4][4];
+            GasketGeometry::splitTetra(parent.v, corners);
+            for (int c = 0; c < 4; ++c) {
+                for (int i = 0; i < 4; ++i) children[c].v[i] = corners[c][i];
+            }
+        }
+
+        static void emit(const Node& leaf, glm::vec3* positions, glm::vec3* colors) {
+            GasketGeometry::emitTetra(leaf.v, positions, colors);
+        }
+    };
+
+    // the other shapes are copies of one unit shape: vertex = unit vertex * Scale + Offset
+    struct ScaledNode {
+        glm::vec3 Offset;
+        float Scale;
+    };
+
+    // child c: half size, pulled towards unit corner c, so it keeps that corner of the parent
+    template <int N>
+    void splitTowards(const ScaledNode& parent, const glm::vec3 (&corners)[N], ScaledNode (&children)[N]) {
+        float half = 0.5f * parent.Scale;
+        for (int c = 0; c < N; ++c) children[c] = { parent.Offset + half * corners[c], half };
+    }
+
+    inline void emitTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& color,
+        glm::vec3* positions, glm::vec3* colors) {
+        positions[0] = a; positions[1] = b; positions[2] = c;
+        colors[0] = colors[1] = colors[2] = color;
+    }
+
+    // Sierpinski triangle in z = 0: front face red, back face blue
+    struct TriangleRule {
+        using Node = ScaledNode;
+        static constexpr int Children = 3;
+        static constexpr int VerticesPerLeaf = 6;
+        static constexpr int MaxLevel = fractalMaxLevel(Fractal::Triangle);
+
+        static const glm::vec3 Corners[3];
+
+        static Node root() { return { glm::vec3(0.0f), 1.0f }; }
+
+        static void split(const Node& parent, Node (&children)[Children]) {
+            splitTowards(parent, Corners, children);
+        }
+
+        static void emit(const Node& leaf, glm::vec3* positions, glm::vec3* colors) {
+            glm::vec3 v[3];
+            for (int i = 0; i < 3; ++i) v[i] = Corners[i] * leaf.Scale + leaf.Offset;
+            emitTriangle(v[0], v[1], v[2], GasketGeometry::faceColors[0], positions, colors);
+            emitTriangle(v[0], v[2], v[1], GasketGeometry::faceColors[2], positions + 3, colors + 3);
+        }
+    };
+
+    // Menger sponge: the 20 sub-cubes of the 3x3x3 grid that lie on an edge or a corner.
+    // Faces are red, green, blue by axis, wound counterclockwise from outside.
+    struct MengerRule {
+        using Node = ScaledNode;
+        static constexpr int Children = 20;
+        static constexpr int VerticesPerLeaf = 36;
+        static constexpr int MaxLevel = fractalMaxLevel(Fractal::Menger);
+
+        static Node root() { return { glm::vec3(0.0f), 1.0f }; }
+
+        static void split(const Node& parent, Node (&children)[Children]) {
+            float third = parent.Scale / 3.0f;
+            int c = 0;
+            for (int i = -1; i <= 1; ++i) {
+                for (int j = -1; j <= 1; ++j) {
+                    for (int k = -1; k <= 1; ++k) {
+                        // the face centers and the middle cube have two or more zero coordinates
+                        if ((i == 0) + (j == 0) + (k == 0) > 1) continue;
+                        children[c++] = { parent.Offset + third * glm::vec3(float(i), float(j), float(k)), third };
+                    }
+                }
+            }
+        }
+
+        static void emit(const Node& leaf, glm::vec3* positions, glm::vec3* colors) {
+            float h = 0.5f * leaf.Scale;
+            for (int axis = 0; axis < 3; ++axis) {
+                glm::vec3 n(0.0f), u(0.0f), v(0.0f);
+                n[axis] = h;
+                u[(axis + 1) % 3] = h;
+                v[(axis + 2) % 3] = h; // u x v points along +axis
+                for (float side : { 1.0f, -1.0f }) {
+                    glm::vec3 center = leaf.Offset + side * n;
+                    glm::vec3 a = center - u - v, b = center + u - v, c = center + u + v, d = center - u + v;
+                    const glm::vec3& color = GasketGeometry::faceColors[axis];
+                    if (side > 0.0f) {
+                        emitTriangle(a, b, c, color, positions, colors);
+                        emitTriangle(a, c, d, color, positions + 3, colors + 3);
+                    }
+                    else {
+                        emitTriangle(a, c, b, color, positions, colors);
+                        emitTriangle(a, d, c, color, positions + 3, colors + 3);
+                    }
+                    positions += 6;
+                    colors += 6;
+                }
+            }
+        }
+    };
+
+    // octahedron flake: 6 half-size octahedra, one at each vertex
+    struct OctahedronRule {
+        using Node = ScaledNode;
+        static constexpr int Children = 6;
+        static constexpr int VerticesPerLeaf = 24;
+        static constexpr int MaxLevel = fractalMaxLevel(Fractal::Octahedron);
+
+        static const glm::vec3 Corners[6]; // +x, -x, +y, -y, +z, -z
+
+        static Node root() { return { glm::vec3(0.0f), 1.0f }; }
+
+        static void split(const Node& parent, Node (&children)[Children]) {
+            splitTowards(parent, Corners, children);
+        }
+
+        static void emit(const Node& leaf, glm::vec3* positions, glm::vec3* colors) {
+            // one face per octant, counterclockwise from outside, colors alternating like a checkerboard
+            int face = 0;
+            for (int sx = 0; sx < 2; ++sx) {
+                for (int sy = 0; sy < 2; ++sy) {
+                    for (int sz = 0; sz < 2; ++sz) {
+                        glm::vec3 x = Corners[sx] * leaf.Scale + leaf.Offset;
+                        glm::vec3 y = Corners[2 + sy] * leaf.Scale + leaf.Offset;
+                        glm::vec3 z = Corners[4 + sz] * leaf.Scale + leaf.Offset;
+                        bool even = (sx + sy + sz) % 2 == 0; // an odd number of flipped axes mirrors the face
+                        const glm::vec3& color = GasketGeometry::faceColors[even ? 0 : 2];
+                        if (even) {
+                            emitTriangle(x, y, z, color, positions + 3 * face, colors + 3 * face);
+                        }
+                        else {
+                            emitTriangle(x, z, y, color, positions + 3 * face, colors + 3 * face);
+                        }
+                        ++face;
+                    }
+                }
+            }
+        }
+    };
+
+    // The shape picked at run time, switched on once per call and then handed to the rule's own walk.
+    // The tetrahedron goes to GasketGeometry::generate, whose LeafKernel batches beat the generic walk.
+    size_t leafCount(Fractal fractal, int level);   // throws past fractalMaxLevel(fractal)
+    size_t vertexCount(Fractal fractal, int level);
+    void generate(Fractal fractal, int level, glm::vec3* positions, glm::vec3* colors, ThreadPool* pool = nullptr,
+        BuildProgress* progress = nullptr);
+}
@@ -0,0 +1,125 @@
+#include "ImageFile.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace ImageFile {
+
+namespace {
+    const std::array<uint32_t, 256>& crcTable() {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t n = 0; n < 256; ++n) {
+                uint32_t c = n;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[n] = c;
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    uint32_t crc(uint32_t c, const uint8_t* data, size_t bytes) {
+        const auto& table = crcTable();
+        for (size_t i = 0; i < bytes; ++i) c = table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+        return c;
+    }
+
+    void bigEndian(std::vector<uint8_t>& out, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+
+    void chunk(std::ofstream& file, const char (&type)[5], const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> head;
+        bigEndian(head, static_cast<uint32_t>(data.size()));
+        head.insert(head.end(), type, type + 4);
+        uint32_t c = crc(0xFFFFFFFFu, head.data() + 4, 4);
+        c = crc(c, data.data(), data.size()) ^ 0xFFFFFFFFu;
+        std::vector<uint8_t> tail;
+        bigEndian(tail, c);
+
+        file.write(reinterpret_cast<const char*>(head.data()), head.size());
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        file.write(reinterpret_cast<const char*>(tail.data()), tail.size());
+    }
+
+    void check(const RgbImage& image) {
+        if (image.Width <= 0 || image.Height <= 0 || image.Pixels.size() != size_t(3) * image.Width * image.Height) {
+            throw std::invalid_argument("Image size does not match its pixels");
+        }
+    }
+}
+
+void writePpm(const std::string& path, const RgbImage& image) {
+    check(image);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("Cannot create image file: " + path);
+    file << "P6\n" << image.Width << ' ' << image.Height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(image.Pixels.data()), image.Pixels.size());
+    if (!file) throw std::runtime_error("Failed to write image file: " + path);
+}
+
+void writePng(const std::string& path, const RgbImage& image) {
+    check(image);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error("Cannot create image file: " + path);
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    std::vector<uint8_t> header;
+    bigEndian(header, static_cast<uint32_t>(image.Width));
+    bigEndian(header, static_cast<uint32_t>(image.Height));
+    header.insert(header.end(), { 8, 2, 0, 0, 0 }); // 8-bit RGB, deflate, no filter, no interlace
+    chunk(file, "IHDR", header);
+
+    // zlib stream of stored blocks over the scanlines, each prefixed with filter type 0
+    const size_t row = size_t(3) * image.Width;
+    std::vector<uint8_t> raw;
+    raw.reserve((row + 1) * image.Height);
+    for (int y = 0; y < image.Height; ++y) {
+        raw.push_back(0);
+        raw.insert(raw.end(), image.Pixels.begin() + y * row, image.Pixels.begin() + (y + 1) * row);
+    }
+
+    std::vector<uint8_t> data = { 0x78, 0x01 };
+    data.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    for (size_t at = 0;;) {
+        size_t bytes = std::min<size_t>(65535, raw.size() - at);
+        bool last = at + bytes == raw.size();
+        data.push_back(last ? 1 : 0);
+        data.push_back(static_cast<uint8_t>(bytes));
+        data.push_back(static_cast<uint8_t>(bytes >> 8));
+        data.push_back(static_cast<uint8_t>(~bytes));
+        data.push_back(static_cast<uint8_t>(~bytes >> 8));
+        data.insert(data.end(), raw.begin() + at, raw.begin() + at + bytes);
+        at += bytes;
+        if (last) break;
+    }
+
+    uint32_t a = 1, b = 0; // Adler-32
+    for (uint8_t v : raw) {
+        a = (a + v) % 65521;
+        b = (b + a) % 65521;
+    }
+    bigEndian(data, (b << 16) | a);
+    chunk(file, "IDAT", data);
+    chunk(file, "IEND", {});
+
+    if (!file) throw std::runtime_error("Failed to write image file: " + path);
+}
+
+void write(const std::string& path, const RgbImage& image) {
+    if (std::filesystem::path(path).extension() == ".png") {
+        writePng(path, image);
+    }
+    else {
+        writePpm(path, image);
+    }
+}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 8-bit RGB pixels, top row first
+struct RgbImage {
+    int Width = 0;
+    int Height = 0;
+    std::vector<uint8_t> Pixels; // 3 * Width * Height
+};
+
+// Writers for images rendered without a window. Both are self-contained: the PNG is stored
+// uncompressed (deflate "stored" blocks), so no zlib is needed. Throws on I/O errors.
+namespace ImageFile {
+    void writePpm(const std::string& path, const RgbImage& image); // binary P6
+    void writePng(const std::string& path, const RgbImage& image);
+    void write(const std::string& path, const RgbImage& image); // by extension: ".png", otherwise PPM
+}
@@ -0,0 +1,170 @@
+#include "LatticeGeometry.h"
+#include "BuildProgress.h"
+#include "../core/ThreadPool.h"
+#include "../core/Trace.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace LatticeGeometry {
+
+namespace {
+    // slices a background build is cut into, as in GasketGeometry
+    constexpr size_t ProgressSlices = 256;
+
+    // corner and face color of the 12 vertices of a leaf, in emitTetra order
+    constexpr int LeafCorner[12] = { 0, 1, 2, 3, 2, 1, 0, 3, 1, 0, 2, 3 };
+    constexpr uint16_t LeafColor[12] = { 0, 0, 0, 3, 3, 3, 2, 2, 2, 1, 1, 1 };
+
+    void checkLevel(int level) {
+        if (level < 0 || level > GasketGeometry::MaxLevel) {
+            throw std::invalid_argument("Subdivision level out of range: " + std::to_string(level));
+        }
+    }
+
+    void checkLattice16(int level) {
+        if (level < 0 || level > VertexPacking::LatticeMaxLevel) {
+            throw std::invalid_argument("Lattice16 supports levels up to " + std::to_string(VertexPacking::LatticeMaxLevel));
+        }
+    }
+
+    uint64_t zigzag(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+}
+
+Tetra root(int level) {
+    checkLevel(level);
+    Tetra tetra;
+    for (int i = 0; i < 4; ++i) {
+        for (int a = 0; a < 3; ++a) tetra.k[i][a] = (i == a + 1) ? (1u << level) : 0u;
+    }
+    return tetra;
+}
+
+void split(const Tetra& parent, Tetra (&children)[4]) {
+    // child c keeps corner c and takes the midpoints of the edges from c
+    for (int c = 0; c < 4; ++c) {
+        for (int i = 0; i < 4; ++i) {
+            for (int a = 0; a < 3; ++a) children[c].k[i][a] = (parent.k[c][a] + parent.k[i][a]) >> 1;
+        }
+    }
+}
+
+Tetra subtree(int level, uint64_t index, int depth) {
+    Tetra tetra = root(level);
+    checkLevel(depth);
+    for (int d = depth - 1; d >= 0; --d) {
+        Tetra children[4];
+        split(tetra, children);
+        tetra = children[(index >> (2 * d)) & 3];
+    }
+    return tetra;
+}
+
+void generate(int level, Tetra* leaves) {
+    GasketGeometry::walkLeaves(root(level), level, split, [&](const Tetra& leaf) { *leaves++ = leaf; });
+}
+
+void emitLattice16(const Tetra& leaf, VertexPacking::Lattice16Vertex* vertices) {
+    for (int v = 0; v < 12; ++v) {
+        const uint32_t* k = leaf.k[LeafCorner[v]];
+        vertices[v] = { static_cast<uint16_t>(k[0]), static_cast<uint16_t>(k[1]), static_cast<uint16_t>(k[2]), LeafColor[v] };
+    }
+}
+
+void generateLattice16(int level, VertexPacking::Lattice16Vertex* vertices) {
+    checkLattice16(level);
+    GasketGeometry::walkLeaves(root(level), level, split, [&](const Tetra& leaf) {
+        emitLattice16(leaf, vertices);
+        vertices += GasketGeometry::VerticesPerTetra;
+    });
+}
+
+void generateLattice16(int level, VertexPacking::Lattice16Vertex* vertices, ThreadPool& pool, BuildProgress* progress) {
+    checkLattice16(level);
+
+    // the same split as GasketGeometry::generate; the roots are cheap to rebuild per subtree
+    size_t wanted = size_t(pool.size()) * 4;
+    if (progress && wanted < ProgressSlices) wanted = ProgressSlices;
+    int splitDepth = 0;
+    while (splitDepth < level && GasketGeometry::tetraCount(splitDepth) < wanted) {
+        ++splitDepth;
+    }
+
+    int subLevel = level - splitDepth;
+    size_t stride = GasketGeometry::vertexCount(subLevel);
+    pool.parallelFor(GasketGeometry::tetraCount(splitDepth), [&](size_t s) {
+        TRACE_ZONE("Lattice16 subtree");
+        if (progress) progress->advance(0);
+        VertexPacking::Lattice16Vertex* out = vertices + s * stride;
+        GasketGeometry::walkLeaves(subtree(level, s, splitDepth), subLevel, split, [&](const Tetra& leaf) {
+            emitLattice16(leaf, out);
+            out += GasketGeometry::VerticesPerTetra;
+        });
+        if (progress) progress->advance(GasketGeometry::tetraCount(subLevel));
+    });
+}
+
+glm::vec3 toFloat(const uint32_t (&k)[3], int level) {
+    const glm::vec3* b = GasketGeometry::baseVertices;
+    double scale = 1.0 / static_cast<double>(uint64_t(1) << level);
+    glm::vec3 position;
+    for (int axis = 0; axis < 3; ++axis) {
+        // k < 2^21 times a difference of two floats: at most 46 significant bits, exact in a double
+        double origin = b[0][axis];
+        double sum = double(k[0]) * (double(b[1][axis]) - origin) + double(k[1]) * (double(b[2][axis]) - origin)
+            + double(k[2]) * (double(b[3][axis]) - origin);
+        position[axis] = static_cast<float>(origin + sum * scale);
+    }
+    return position;
+}
+
+void Encoder::add(const Tetra& leaf) {
+    for (int i = 0; i < 4; ++i) {
+        for (int a = 0; a < 3; ++a) {
+            uint64_t value = zigzag(int64_t(leaf.k[i][a]) - int64_t(Previous.k[i][a]));
+            while (value >= 0x80) {
+                Out.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            Out.push_back(static_cast<uint8_t>(value));
+        }
+    }
+    Previous = leaf;
+}
+
+Decoder::Decoder(const uint8_t* data, size_t bytes, int level) : Data(data), End(data + bytes) {
+    checkLattice16(level);
+    Limit = uint32_t(1) << level;
+}
+
+bool Decoder::next(Tetra& leaf) {
+    for (int i = 0; i < 4; ++i) {
+        for (int a = 0; a < 3; ++a) {
+            // a coordinate delta needs at most 23 bits zigzagged: 4 varint bytes
+            uint64_t value = 0;
+            int shift = 0;
+            while (true) {
+                if (Data == End || shift > 21) return false;
+                uint8_t byte = *Data++;
+                value |= uint64_t(byte & 0x7f) << shift;
+                shift += 7;
+                if (!(byte & 0x80)) break;
+            }
+            int64_t k = int64_t(Previous.k[i][a]) + unzigzag(value);
+            if (k < 0 || k > Limit) return false;
+            leaf.k[i][a] = static_cast<uint32_t>(k);
+        }
+        // inside the base tetra: the implied fourth barycentric coordinate is not negative
+        if (uint64_t(leaf.k[i][0]) + leaf.k[i][1] + leaf.k[i][2] > Limit) return false;
+    }
+    Previous = leaf;
+    return true;
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "GasketGeometry.h"
+#include "VertexFormat.h"
+
+class ThreadPool;
+struct BuildProgress;
+
+// Integer core of the gasket. Every corner at level L is
+//   baseVertices[0] + sum_a k[a] / 2^L * (baseVertices[a + 1] - baseVertices[0])
+// with integers k[a] >= 0 summing to at most 2^L, and the midpoint of two corners is (k + k') / 2, always
+// exact. So the mesh is the same bits on every compiler, CPU and thread count, equal corners are equal
+// keys, and floats only appear at the end: in toFloat(), or in gasket.vert for Lattice16 vertices.
+namespace LatticeGeometry {
+    // lattice coordinates of the 4 corners of a tetra, scaled to the level of the whole walk
+    struct Tetra {
+        uint32_t k[4][3];
+    };
+
+    Tetra root(int level); // the base tetra: corner 0 at k = 0, corner i at 2^level on axis i - 1
+    void split(const Tetra& parent, Tetra (&children)[4]); // splitTetra order
+    Tetra subtree(int level, uint64_t index, int depth); // see GasketGeometry::subtreeCorners
+
+    // the tetraCount(level) leaves in dividePyramid order
+    void generate(int level, Tetra* leaves);
+
+    // Lattice16 vertices straight from the integer walk, 12 per leaf in emitTetra order, identical to packing
+    // GasketGeometry::generate() output; with a pool, subtrees run in parallel on contiguous slices.
+    // Progress: one unit per leaf.
+    void generateLattice16(int level, VertexPacking::Lattice16Vertex* vertices);
+    void generateLattice16(int level, VertexPacking::Lattice16Vertex* vertices, ThreadPool& pool,
+        BuildProgress* progress = nullptr);
+    void emitLattice16(const Tetra& leaf, VertexPacking::Lattice16Vertex* vertices);
+
+    // Position of a corner. The products are exact in double, so the result does not depend on FMA
+    // contraction, and rounds to the same float everywhere. Within an ulp or so of the float walk.
+    glm::vec3 toFloat(const uint32_t (&k)[3], int level);
+
+    // Delta + varint stream of leaves: for each leaf, corner and axis, the zigzag-coded difference from the
+    // same coordinate of the previous leaf as an LEB128 varint. Neighbouring leaves are siblings, so almost
+    // every delta fits one byte: about 12 bytes per leaf against 96 for Lattice16 and 288 for Float32.
+    class Encoder {
+    public:
+        explicit Encoder(std::vector<uint8_t>& out) : Out(out) {}
+        void add(const Tetra& leaf);
+
+    private:
+        std::vector<uint8_t>& Out;
+        Tetra Previous = {};
+    };
+
+    // Leaves of a level-level stream, which must be a Lattice16 level (0 to LatticeMaxLevel): every corner
+    // is checked to lie in the base tetra at that level, so emitLattice16 can store it in 16 bits.
+    class Decoder {
+    public:
+        Decoder(const uint8_t* data, size_t bytes, int level);
+        bool next(Tetra& leaf); // false at the end of the data, on a malformed varint or a corner out of range
+        bool finished() const { return Data == End; }
+
+    private:
+        const uint8_t* Data;
+        const uint8_t* End;
+        uint32_t Limit; // 2^level
+        Tetra Previous = {};
+    };
+}
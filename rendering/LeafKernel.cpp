@@ -0,0 +1,115 @@
+#include "LeafKernel.h"
+#include "LeafKernelEmit.h"
+
+#if defined(_MSC_VER) && defined(GASKET_X86_KERNELS)
+#include <intrin.h>
+#elif defined(GASKET_X86_KERNELS)
+#include <cpuid.h>
+#endif
+
+namespace LeafKernel {
+
+namespace {
+    struct ScalarOps {
+        static constexpr int Width = 1;
+        using Reg = float;
+        static Reg set1(float f) { return f; }
+        static Reg load(const float* p) { return *p; }
+        static void store(float* p, Reg r) { *p = r; }
+        static Reg add(Reg a, Reg b) { return a + b; }
+        static Reg mul(Reg a, Reg b) { return a * b; }
+        static float* emit(const float (&points)[PointCount][3][Width], int lanes, float* out) {
+            return emitLanes<Width>(points, lanes, out);
+        }
+    };
+
+#ifdef GASKET_X86_KERNELS
+    void cpuid(int leaf, int subleaf, unsigned (&regs)[4]) {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuidex(info, leaf, subleaf);
+        for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned>(info[i]);
+#else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    // register state the OS saves on context switch (XCR0)
+    unsigned long long xgetbv0() {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        unsigned eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+    }
+
+    Isa queryCpu() {
+        unsigned regs[4];
+        cpuid(0, 0, regs);
+        unsigned maxLeaf = regs[0];
+
+        cpuid(1, 0, regs);
+        bool sse41 = (regs[2] & (1u << 19)) != 0;
+        bool osxsave = (regs[2] & (1u << 27)) != 0;
+        bool avx = (regs[2] & (1u << 28)) != 0;
+        if (!sse41) return Isa::Scalar;
+        if (!osxsave || !avx || maxLeaf < 7) return Isa::SSE4;
+
+        unsigned long long xcr0 = xgetbv0();
+        bool ymmState = (xcr0 & 0x6) == 0x6;    // XMM + YMM
+        bool zmmState = (xcr0 & 0xE6) == 0xE6;  // + opmask, ZMM0-15 upper, ZMM16-31
+
+        cpuid(7, 0, regs);
+        bool avx2 = (regs[1] & (1u << 5)) != 0;
+        bool avx512f = (regs[1] & (1u << 16)) != 0;
+
+        if (avx512f && zmmState) return Isa::AVX512;
+        if (avx2 && ymmState) return Isa::AVX2;
+        return Isa::SSE4;
+    }
+#endif
+}
+
+void scalarKernel(const ParentBatch& batch, int count, float* positions) {
+    runKernel<ScalarOps>(batch, count, positions);
+}
+
+Isa detectIsa() {
+#ifdef GASKET_X86_KERNELS
+    static const Isa isa = queryCpu();
+    return isa;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::SSE4: return "SSE4";
+    case Isa::AVX2: return "AVX2";
+    case Isa::AVX512: return "AVX-512";
+    default: return "Scalar";
+    }
+}
+
+Kernel kernel(Isa isa) {
+    if (static_cast<int>(isa) > static_cast<int>(detectIsa())) return nullptr;
+
+    switch (isa) {
+#ifdef GASKET_X86_KERNELS
+    case Isa::SSE4: return sse4Kernel;
+    case Isa::AVX2: return avx2Kernel;
+    case Isa::AVX512: return avx512Kernel;
+#endif
+    default: return scalarKernel;
+    }
+}
+
+Kernel best() {
+    static const Kernel selected = kernel(detectIsa());
+    return selected;
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// SIMD kernels for the last subdivision step: a batch of parent tetras (one level above the leaves)
+// is split into its 4 corner children, and the 48 leaf vertices of every parent are written out.
+//
+// The per-ISA kernels live in their own translation units built with their own -m/arch flags,
+// so this header must stay free of glm and any other inline code shared with the rest of the build.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GASKET_X86_KERNELS 1
+#endif
+
+namespace LeafKernel {
+    constexpr int BatchCapacity = 16;
+    constexpr int VerticesPerParent = 48; // 4 leaves * 12 vertices
+
+    // structure-of-arrays batch: corner i of parent n is (x[i][n], y[i][n], z[i][n])
+    struct ParentBatch {
+        alignas(64) float x[4][BatchCapacity];
+        alignas(64) float y[4][BatchCapacity];
+        alignas(64) float z[4][BatchCapacity];
+    };
+
+    // writes count * VerticesPerParent packed xyz positions
+    using Kernel = void (*)(const ParentBatch& batch, int count, float* positions);
+
+    enum class Isa {
+        Scalar,
+        SSE4,
+        AVX2,
+        AVX512
+    };
+
+    Isa detectIsa();            // widest ISA both compiled in and supported by this CPU / OS
+    const char* isaName(Isa isa);
+    Kernel kernel(Isa isa);     // nullptr if that ISA is not available
+    Kernel best();              // kernel(detectIsa()), resolved once
+
+    void scalarKernel(const ParentBatch& batch, int count, float* positions);
+#ifdef GASKET_X86_KERNELS
+    void sse4Kernel(const ParentBatch& batch, int count, float* positions);
+    void avx2Kernel(const ParentBatch& batch, int count, float* positions);
+    void avx512Kernel(const ParentBatch& batch, int count, float* positions);
+#endif
+}
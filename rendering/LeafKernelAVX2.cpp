@@ -0,0 +1,29 @@
+#include "LeafKernel.h"
+
+#ifdef GASKET_X86_KERNELS
+#include "LeafKernelEmit.h"
+#include <immintrin.h>
+
+namespace LeafKernel {
+
+namespace {
+    struct AVX2Ops {
+        static constexpr int Width = 8;
+        using Reg = __m256;
+        static Reg set1(float f) { return _mm256_set1_ps(f); }
+        static Reg load(const float* p) { return _mm256_load_ps(p); }
+        static void store(float* p, Reg r) { _mm256_store_ps(p, r); }
+        static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+        static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+        static float* emit(const float (&points)[PointCount][3][Width], int lanes, float* out) {
+            return emitLanesSse<Width>(points, lanes, out);
+        }
+    };
+}
+
+void avx2Kernel(const ParentBatch& batch, int count, float* positions) {
+    runKernel<AVX2Ops>(batch, count, positions);
+}
+
+}
+#endif
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "LeafKernel.h"
+
+// GCC and Clang only allow SSE4.1 intrinsics in units built with -msse4.1 or wider; MSVC allows them anywhere
+#if defined(__SSE4_1__) || (defined(_MSC_VER) && defined(GASKET_X86_KERNELS))
+#define GASKET_EMIT_SSE 1
+#include <immintrin.h>
+#endif
+
+// Shared by every LeafKernel translation unit. Everything here has internal linkage on purpose:
+// an inline function compiled with -mavx512f in one unit must never be picked up by another.
+namespace LeafKernel {
+namespace {
+
+    // the 10 points of a split tetra: v1..v4, then m12, m13, m14, m23, m24, m34
+    enum { PointCount = 10 };
+
+    // child c of TetraGasket's split, as indices into the 10 points
+    constexpr int ChildCorners[4][4] = {
+        { 0, 4, 5, 6 },
+        { 4, 1, 7, 8 },
+        { 5, 7, 2, 9 },
+        { 6, 8, 9, 3 }
+    };
+
+    // triangle order of a leaf tetra: red, black, blue, green
+    constexpr int LeafOrder[12] = { 0, 1, 2, 3, 2, 1, 0, 3, 1, 0, 2, 3 };
+
+    struct EmitTable {
+        int point[VerticesPerParent];
+    };
+
+    constexpr EmitTable makeEmitTable() {
+        EmitTable table{};
+        for (int c = 0; c < 4; ++c) {
+            for (int k = 0; k < 12; ++k) {
+                table.point[c * 12 + k] = ChildCorners[c][LeafOrder[k]];
+            }
+        }
+        return table;
+    }
+
+    constexpr EmitTable Emit = makeEmitTable();
+
+    // points[p][axis][lane] (SoA, Width lanes) -> packed xyz leaf vertices of one lane
+    template <int Width>
+    inline float* emitLane(const float (&points)[PointCount][3][Width], int lane, float* out) {
+        for (int k = 0; k < VerticesPerParent; ++k) {
+            int p = Emit.point[k];
+            out[0] = points[p][0][lane];
+            out[1] = points[p][1][lane];
+            out[2] = points[p][2][lane];
+            out += 3;
+        }
+        return out;
+    }
+
+    template <int Width>
+    inline float* emitLanes(const float (&points)[PointCount][3][Width], int lanes, float* out) {
+        for (int lane = 0; lane < lanes; ++lane) out = emitLane<Width>(points, lane, out);
+        return out;
+    }
+
+#ifdef GASKET_EMIT_SSE
+    // emitLanes with 4-wide moves, for the units built with SSE4.1 or wider. Each point is transposed
+    // once from SoA into (x, y, z, 0) per lane; then every 4 vertices (12 floats) go out as 3 stores,
+    // interleaved with shuffles and blends instead of 12 scalar copies.
+    template <int Width>
+    inline float* emitLanesSse(const float (&points)[PointCount][3][Width], int lanes, float* out) {
+        static_assert(Width % 4 == 0, "lanes are transposed 4 at a time");
+        alignas(16) float corners[Width][PointCount][4];
+        const __m128 zero = _mm_setzero_ps();
+        for (int p = 0; p < PointCount; ++p) {
+            for (int group = 0; group < Width; group += 4) {
+                __m128 x = _mm_load_ps(&points[p][0][group]);
+                __m128 y = _mm_load_ps(&points[p][1][group]);
+                __m128 z = _mm_load_ps(&points[p][2][group]);
+                __m128 xyLow = _mm_unpacklo_ps(x, y); // x0 y0 x1 y1
+                __m128 xyHigh = _mm_unpackhi_ps(x, y); // x2 y2 x3 y3
+                __m128 zLow = _mm_unpacklo_ps(z, zero); // z0 0 z1 0
+                __m128 zHigh = _mm_unpackhi_ps(z, zero); // z2 0 z3 0
+                _mm_store_ps(corners[group + 0][p], _mm_movelh_ps(xyLow, zLow));
+                _mm_store_ps(corners[group + 1][p], _mm_movehl_ps(zLow, xyLow));
+                _mm_store_ps(corners[group + 2][p], _mm_movelh_ps(xyHigh, zHigh));
+                _mm_store_ps(corners[group + 3][p], _mm_movehl_ps(zHigh, xyHigh));
+            }
+        }
+
+        for (int lane = 0; lane < lanes; ++lane) {
+            const float (&corner)[PointCount][4] = corners[lane];
+            for (int k = 0; k < VerticesPerParent; k += 4) {
+                __m128 a = _mm_load_ps(corner[Emit.point[k + 0]]);
+                __m128 b = _mm_load_ps(corner[Emit.point[k + 1]]);
+                __m128 c = _mm_load_ps(corner[Emit.point[k + 2]]);
+                __m128 d = _mm_load_ps(corner[Emit.point[k + 3]]);
+                // a.xyz b.x | b.yz c.xy | c.z d.xyz
+                _mm_storeu_ps(out, _mm_blend_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)), 0x8));
+                _mm_storeu_ps(out + 4, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 2, 1)));
+                _mm_storeu_ps(out + 8, _mm_blend_ps(_mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 1, 0, 0)), _mm_movehl_ps(c, c), 0x1));
+                out += 12;
+            }
+        }
+        return out;
+    }
+#endif
+
+    // Shared kernel body. Ops supplies Width, a register type Reg, load/store/add/mul on it, and
+    // emit(points, lanes, out), which writes the leaf vertices of the first lanes (emitLanes or emitLanesSse).
+    // Midpoints are (a + b) * 0.5 exactly like the scalar path, so every ISA gives bit-identical output.
+    template <typename Ops>
+    inline void runKernel(const ParentBatch& batch, int count, float* positions) {
+        constexpr int Width = Ops::Width;
+        constexpr int Pairs[6][2] = { { 0, 1 }, { 0, 2 }, { 0, 3 }, { 1, 2 }, { 1, 3 }, { 2, 3 } };
+
+        alignas(64) float points[PointCount][3][Width];
+        const typename Ops::Reg half = Ops::set1(0.5f);
+
+        for (int base = 0; base < count; base += Width) {
+            for (int axis = 0; axis < 3; ++axis) {
+                const float (&src)[4][BatchCapacity] = (axis == 0) ? batch.x : (axis == 1) ? batch.y : batch.z;
+
+                typename Ops::Reg v[4];
+                for (int i = 0; i < 4; ++i) {
+                    v[i] = Ops::load(&src[i][base]);
+                    Ops::store(points[i][axis], v[i]);
+                }
+                for (int m = 0; m < 6; ++m) {
+                    Ops::store(points[4 + m][axis], Ops::mul(Ops::add(v[Pairs[m][0]], v[Pairs[m][1]]), half));
+                }
+            }
+
+            int lanes = (count - base < Width) ? count - base : Width;
+            positions = Ops::emit(points, lanes, positions);
+        }
+    }
+
+}
+}
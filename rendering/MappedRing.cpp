@@ -0,0 +1,52 @@
+#include "MappedRing.h"
+
+#include <cstdint>
+
+void* MappedRing::acquire(size_t bytes, size_t& offset) {
+    if (bytes > RegionBytes) {
+        // round up so a slowly growing size does not reallocate every time
+        size_t regionBytes = 4096;
+        while (regionBytes < bytes) regionBytes <<= 1;
+        allocate(regionBytes);
+    }
+
+    Region = (Region + 1) % Regions;
+    if (Fences[Region]) {
+        // normally long signalled: the region was last drawn Regions - 1 frames ago
+        while (glClientWaitSync(Fences[Region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(Fences[Region]);
+        Fences[Region] = 0;
+    }
+
+    offset = Region * RegionBytes;
+    return static_cast<uint8_t*>(Mapped) + offset;
+}
+
+void MappedRing::fence() {
+    if (!Buffer) return;
+    if (Fences[Region]) glDeleteSync(Fences[Region]);
+    Fences[Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void MappedRing::allocate(size_t regionBytes) {
+    // the old storage may still be read by queued draws; deleting it is deferred by GL until they finish
+    release();
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &Buffer);
+    glNamedBufferStorage(Buffer, regionBytes * Regions, nullptr, flags);
+    Mapped = glMapNamedBufferRange(Buffer, 0, regionBytes * Regions, flags);
+    RegionBytes = regionBytes;
+    Region = 0;
+}
+
+void MappedRing::release() {
+    for (GLsync& sync : Fences) {
+        if (sync) glDeleteSync(sync);
+        sync = 0;
+    }
+    if (Buffer != 0) glDeleteBuffers(1, &Buffer);
+    Buffer = 0;
+    Mapped = nullptr;
+    RegionBytes = 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+
+// Persistent-mapped buffer split into regions that are rewritten round-robin.
+// A region is only written again once the GPU has finished the draw that last read it,
+// tracked with one fence per region. Needs the GL context for every call.
+class MappedRing {
+public:
+    static constexpr int Regions = 3;
+
+    // pointer to write bytes at; offset is where they start in buffer().
+    // Waits for the region's last reader and grows the storage when bytes does not fit.
+    void* acquire(size_t bytes, size_t& offset);
+
+    // call after the draw that reads the last acquired region
+    void fence();
+
+    GLuint buffer() const { return Buffer; }
+    void release();
+
+private:
+    void allocate(size_t regionBytes);
+
+    GLuint Buffer = 0;
+    void* Mapped = nullptr;
+    size_t RegionBytes = 0;
+    int Region = 0;
+    GLsync Fences[Regions] = {};
+};
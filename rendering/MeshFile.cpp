@@ -0,0 +1,256 @@
+#include "MeshFile.h"
+#include "GeometryCache.h"
+#include "IfsRules.h"
+#include "LatticeGeometry.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    const char Magic[8] = { 'G', 'A', 'S', 'K', 'M', 'E', 'S', 'H' };
+
+    const char* modeToken(GasketMode mode) {
+        switch (mode) {
+        case GasketMode::Triangles: return "triangles";
+        case GasketMode::Indexed: return "indexed";
+        case GasketMode::Instanced: return "instanced";
+        case GasketMode::Procedural: return "procedural";
+        case GasketMode::Lod: return "lod";
+        case GasketMode::Chunked: return "chunked";
+        default: return "unknown";
+        }
+    }
+
+    // the tetrahedron keeps the plain names
+    const char* shapeToken(Fractal shape) {
+        switch (shape) {
+        case Fractal::Triangle: return "triangle-";
+        case Fractal::Menger: return "menger-";
+        case Fractal::Octahedron: return "octahedron-";
+        default: return "";
+        }
+    }
+
+    const char* formatToken(VertexFormat format) {
+        switch (format) {
+        case VertexFormat::Float32: return "float32";
+        case VertexFormat::Snorm16: return "snorm16";
+        case VertexFormat::Lattice16: return "lattice16";
+        default: return "unknown";
+        }
+    }
+
+    bool latticeEncoded(const GasketLevel& level) {
+        return level.Mode == GasketMode::Triangles && level.Format == VertexFormat::Lattice16;
+    }
+
+    // the first 4 vertices a leaf emits are its corners
+    void encodeLattice(const void* data, size_t vertices, std::vector<uint8_t>& out) {
+        const VertexPacking::Lattice16Vertex* v = static_cast<const VertexPacking::Lattice16Vertex*>(data);
+        out.reserve(vertices); // about 1 byte per vertex
+        LatticeGeometry::Encoder encoder(out);
+        for (size_t first = 0; first < vertices; first += GasketGeometry::VerticesPerTetra) {
+            LatticeGeometry::Tetra leaf;
+            for (int i = 0; i < 4; ++i) {
+                leaf.k[i][0] = v[first + i].k1;
+                leaf.k[i][1] = v[first + i].k2;
+                leaf.k[i][2] = v[first + i].k3;
+            }
+            encoder.add(leaf);
+        }
+    }
+
+    bool decodeLattice(const uint8_t* data, size_t bytes, int level, size_t vertices, std::pmr::vector<uint8_t>& out) {
+        if (level < 0 || level > VertexPacking::LatticeMaxLevel) return false;
+        size_t leaves = vertices / GasketGeometry::VerticesPerTetra;
+        out.resize(vertices * sizeof(VertexPacking::Lattice16Vertex));
+        VertexPacking::Lattice16Vertex* v = reinterpret_cast<VertexPacking::Lattice16Vertex*>(out.data());
+        LatticeGeometry::Decoder decoder(data, bytes, level);
+        for (size_t leaf = 0; leaf < leaves; ++leaf) {
+            LatticeGeometry::Tetra corners;
+            if (!decoder.next(corners)) return false;
+            LatticeGeometry::emitLattice16(corners, v + leaf * GasketGeometry::VerticesPerTetra);
+        }
+        return decoder.finished();
+    }
+
+    // The counts must be those of the level asked for, and every stream exactly as long as its count
+    // times its stride, so a file that passes can be uploaded and drawn as it is. Index values are
+    // checked too, since the draw reads vertices through them.
+    bool streamsMatch(const MeshFile::Header& header, const GasketLevel& level, const uint8_t* base) {
+        const uint64_t perTetra = GasketGeometry::VerticesPerTetra;
+        uint64_t vertices = header.VertexCount;
+        uint64_t instances = 0;
+        uint64_t indices = 0;
+        switch (level.Mode) {
+        case GasketMode::Triangles:
+            if (vertices != Ifs::vertexCount(level.Shape, level.Level)) return false;
+            break;
+        case GasketMode::Indexed:
+            indices = GasketGeometry::tetraCount(level.Level) * perTetra;
+            if (vertices == 0 || vertices > indices) return false; // every vertex is used by some triangle
+            break;
+        case GasketMode::Instanced:
+            instances = GasketGeometry::tetraCount(level.Level);
+            if (vertices != perTetra) return false;
+            break;
+        default:
+            return false;
+        }
+        if (header.InstanceCount != instances || header.IndexCount != indices) return false;
+
+        uint64_t expected[GasketLevel::StreamCount] = {};
+        // Float32 is two streams of vec3, the compact formats one interleaved stream
+        bool float32 = level.Format == VertexFormat::Float32;
+        expected[GasketLevel::PositionStream] = vertices * (float32 ? sizeof(glm::vec3) : VertexPacking::stride(level.Format));
+        expected[GasketLevel::ColorStream] = float32 ? vertices * sizeof(glm::vec3) : 0;
+        expected[GasketLevel::OffsetStream] = instances * sizeof(glm::vec3);
+        expected[GasketLevel::IndexStream] = indices * sizeof(uint32_t);
+        for (int i = 0; i < GasketLevel::StreamCount; ++i) {
+            // the varint position stream has no fixed length; decodeLattice checks it against the vertex count
+            if (i == GasketLevel::PositionStream && header.Encoding == MeshFile::LatticeVarint) {
+                if (header.StreamBytes[i] == 0) return false;
+                continue;
+            }
+            if (header.StreamBytes[i] != expected[i]) return false;
+        }
+
+        if (indices > 0) {
+            // StreamOffset is a multiple of StreamAlignment, so the mapping is aligned for uint32_t
+            const uint32_t* first = reinterpret_cast<const uint32_t*>(base + header.StreamOffset[GasketLevel::IndexStream]);
+            if (*std::max_element(first, first + indices) >= vertices) return false;
+        }
+        return true;
+    }
+
+    uint64_t alignUp(uint64_t value) {
+        return (value + MeshFile::StreamAlignment - 1) / MeshFile::StreamAlignment * MeshFile::StreamAlignment;
+    }
+}
+
+std::string MeshFile::path(const std::string& directory, Fractal shape, GasketMode mode, VertexFormat format, int level) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%s-%s-L%02d.gmesh", shapeToken(shape), modeToken(mode), formatToken(format),
+        level);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool MeshFile::write(const std::string& path, const GasketLevel& level) {
+    if (level.MappedPosition || level.MappedColor || level.MappedOffset) return false;
+
+    Header header = {};
+    std::memcpy(header.Magic, Magic, sizeof(Magic));
+    header.Version = Version;
+    header.Shape = static_cast<uint32_t>(level.Shape);
+    header.Mode = static_cast<uint32_t>(level.Mode);
+    header.Format = static_cast<uint32_t>(level.Format);
+    header.Level = level.Level;
+    header.VertexCount = level.VertexCount;
+    header.IndexCount = level.IndexCount;
+    header.InstanceCount = level.InstanceCount;
+    header.Scale = level.Scale;
+    header.LatticeScale = level.LatticeScale;
+    header.ProceduralLevel = level.ProceduralLevel;
+
+    const void* data[GasketLevel::StreamCount];
+    std::vector<uint8_t> encoded;
+    uint64_t end = alignUp(sizeof(Header));
+    for (int i = 0; i < GasketLevel::StreamCount; ++i) {
+        size_t bytes;
+        level.streamData(i, data[i], bytes);
+        if (i == GasketLevel::PositionStream && bytes > 0 && latticeEncoded(level)) {
+            encodeLattice(data[i], level.VertexCount, encoded);
+            header.Encoding = LatticeVarint;
+            data[i] = encoded.data();
+            bytes = encoded.size();
+        }
+        header.StreamOffset[i] = bytes ? end : 0;
+        header.StreamBytes[i] = bytes;
+        end = alignUp(end + bytes);
+    }
+
+    std::filesystem::path target(path);
+    if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path());
+    std::filesystem::path temporary = target;
+    temporary += ".tmp";
+
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Cannot create mesh cache file: " + temporary.string());
+
+        const char padding[StreamAlignment] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t written = sizeof(header);
+        for (int i = 0; i < GasketLevel::StreamCount; ++i) {
+            if (header.StreamBytes[i] == 0) continue;
+            out.write(padding, static_cast<std::streamsize>(header.StreamOffset[i] - written));
+            out.write(static_cast<const char*>(data[i]), static_cast<std::streamsize>(header.StreamBytes[i]));
+            written = header.StreamOffset[i] + header.StreamBytes[i];
+        }
+        if (!out) throw std::runtime_error("Failed to write mesh cache file: " + temporary.string());
+    }
+
+    // rename does not replace an existing file everywhere
+    std::error_code ignored;
+    std::filesystem::remove(target, ignored);
+    std::filesystem::rename(temporary, target);
+    return true;
+}
+
+bool MeshFile::load(const std::string& path, GasketLevel& level) {
+    if (!level.File.open(path)) return false;
+
+    const uint8_t* base = level.File.data();
+    size_t size = level.File.size();
+    Header header;
+    if (size < sizeof(Header)) {
+        level.File.close();
+        return false;
+    }
+    std::memcpy(&header, base, sizeof(Header));
+
+    bool valid = std::memcmp(header.Magic, Magic, sizeof(Magic)) == 0 && header.Version == Version
+        && header.Shape == static_cast<uint32_t>(level.Shape) && header.Mode == static_cast<uint32_t>(level.Mode)
+        && header.Format == static_cast<uint32_t>(level.Format) && header.Level == level.Level
+        && header.Encoding == (latticeEncoded(level) ? LatticeVarint : Raw);
+    for (int i = 0; valid && i < GasketLevel::StreamCount; ++i) {
+        valid = header.StreamOffset[i] <= size && header.StreamBytes[i] <= size - header.StreamOffset[i]
+            && header.StreamOffset[i] % StreamAlignment == 0;
+    }
+    if (!valid || !streamsMatch(header, level, base)) {
+        level.File.close();
+        return false;
+    }
+
+    level.VertexCount = static_cast<size_t>(header.VertexCount);
+    level.IndexCount = static_cast<size_t>(header.IndexCount);
+    level.InstanceCount = static_cast<size_t>(header.InstanceCount);
+    level.Scale = header.Scale;
+    level.LatticeScale = header.LatticeScale;
+    level.ProceduralLevel = header.ProceduralLevel;
+    for (int i = 0; i < GasketLevel::StreamCount; ++i) {
+        level.FileStreams[i] = header.StreamBytes[i] ? base + header.StreamOffset[i] : nullptr;
+        level.FileStreamBytes[i] = static_cast<size_t>(header.StreamBytes[i]);
+    }
+
+    if (header.Encoding == LatticeVarint) {
+        const int position = GasketLevel::PositionStream;
+        bool decoded = level.VertexCount % GasketGeometry::VerticesPerTetra == 0
+            && decodeLattice(level.FileStreams[position], level.FileStreamBytes[position], level.Level,
+                level.VertexCount, level.Packed);
+        level.FileStreams[position] = nullptr;
+        level.FileStreamBytes[position] = 0;
+        if (!decoded) {
+            level.Packed.clear();
+            level.File.close();
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Fractal.h"
+#include "GasketMode.h"
+#include "VertexFormat.h"
+
+struct GasketLevel;
+
+// On-disk copy of a generated level: a fixed header followed by each GPU stream exactly as it is
+// uploaded, so loading is a mapping plus pointer arithmetic. Native byte order; files from another
+// version are rejected and rebuilt.
+// The one exception is Lattice16 Triangles, whose position stream is stored as the LatticeGeometry
+// delta + varint stream of leaf corners, 8x smaller, and decoded on load.
+namespace MeshFile {
+    constexpr uint32_t Version = 3;
+    constexpr size_t StreamAlignment = 64;
+
+    enum Encoding : uint32_t {
+        Raw = 0,           // every stream as uploaded
+        LatticeVarint = 1, // position stream: LatticeGeometry::Encoder leaves
+    };
+
+    struct Header {
+        char Magic[8]; // "GASKMESH"
+        uint32_t Version;
+        uint32_t Mode;
+        uint32_t Format;
+        int32_t Level;
+        uint64_t VertexCount;
+        uint64_t IndexCount;
+        uint64_t InstanceCount;
+        float Scale;
+        float LatticeScale;
+        int32_t ProceduralLevel;
+        uint32_t Shape; // Fractal
+        uint32_t Encoding;
+        uint32_t Reserved;
+        uint64_t StreamOffset[4]; // from the start of the file, in GasketLevel::Stream order
+        uint64_t StreamBytes[4];
+    };
+
+    // e.g. "cache/triangles-float32-L09.gmesh", "cache/menger-triangles-float32-L03.gmesh"
+    std::string path(const std::string& directory, Fractal shape, GasketMode mode, VertexFormat format, int level);
+
+    // false if a stream only exists in mapped GL storage; throws on I/O errors.
+    // Written to a temporary name first, so a crash never leaves a truncated file behind.
+    bool write(const std::string& path, const GasketLevel& level);
+
+    // maps the file into level.File and points level.FileStreams into it; false if missing, from
+    // another version, not the (shape, mode, format, level) asked for, or with counts, stream lengths
+    // or index values that do not fit that level
+    bool load(const std::string& path, GasketLevel& level);
+}
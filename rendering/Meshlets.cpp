@@ -0,0 +1,101 @@
+#include "Meshlets.h"
+#include "GasketGeometry.h"
+#include "../core/ThreadPool.h"
+#include "../core/Trace.h"
+
+#include <algorithm>
+
+namespace Meshlets {
+
+namespace {
+    void bound(const glm::vec3* points, size_t count, Meshlet& meshlet) {
+        glm::vec3 lo = points[0], hi = points[0];
+        for (size_t i = 1; i < count; ++i) {
+            lo = glm::min(lo, points[i]);
+            hi = glm::max(hi, points[i]);
+        }
+        meshlet.BoxMin = lo;
+        meshlet.BoxMax = hi;
+
+        glm::vec3 center = 0.5f * (lo + hi);
+        float radius = 0.0f;
+        for (size_t i = 0; i < count; ++i) radius = std::max(radius, glm::length(points[i] - center));
+        meshlet.Center = center;
+        meshlet.Radius = radius;
+    }
+
+    void buildOne(const glm::vec3* positions, size_t first, size_t count, Meshlet& meshlet) {
+        bound(positions + first, count, meshlet);
+        meshlet.FirstVertex = static_cast<uint32_t>(first);
+        meshlet.VertexCount = static_cast<uint32_t>(count);
+    }
+}
+
+void build(const glm::vec3* positions, size_t vertexCount, size_t verticesPerMeshlet, std::vector<Meshlet>& meshlets,
+    ThreadPool* pool) {
+    TRACE_ZONE("Meshlets::build");
+    size_t count = (vertexCount + verticesPerMeshlet - 1) / verticesPerMeshlet;
+    meshlets.resize(count);
+    auto one = [&](size_t m) {
+        size_t first = m * verticesPerMeshlet;
+        buildOne(positions, first, std::min(verticesPerMeshlet, vertexCount - first), meshlets[m]);
+    };
+    if (pool && count > 1) {
+        pool->parallelFor(count, one);
+    }
+    else {
+        for (size_t m = 0; m < count; ++m) one(m);
+    }
+}
+
+void buildGasket(int level, std::vector<Meshlet>& meshlets) {
+    int depth = std::max(level - LeafLevels, 0);
+    size_t vertices = GasketGeometry::vertexCount(level - depth);
+    size_t count = GasketGeometry::tetraCount(depth);
+    meshlets.resize(count);
+
+    // the subtrees at one depth, expanded in place like generateOffsets
+    std::vector<glm::vec3> corners(4 * count);
+    for (int i = 0; i < 4; ++i) corners[i] = GasketGeometry::baseVertices[i];
+    for (size_t n = 1; n < count; n *= 4) {
+        for (size_t i = n; i-- > 0;) {
+            glm::vec3 parent[4] = { corners[4 * i], corners[4 * i + 1], corners[4 * i + 2], corners[4 * i + 3] };
+            glm::vec3 children[4][4];
+            GasketGeometry::splitTetra(parent, children);
+            for (int c = 0; c < 4; ++c) {
+                for (int k = 0; k < 4; ++k) corners[4 * (4 * i + c) + k] = children[c][k];
+            }
+        }
+    }
+
+    for (size_t m = 0; m < count; ++m) {
+        Meshlet& meshlet = meshlets[m];
+        bound(&corners[4 * m], 4, meshlet);
+        meshlet.FirstVertex = static_cast<uint32_t>(m * vertices);
+        meshlet.VertexCount = static_cast<uint32_t>(vertices);
+    }
+}
+
+void cull(const std::vector<Meshlet>& meshlets, const glm::mat4& view, const glm::mat4& projection,
+    std::vector<int>& first, std::vector<int>& count) {
+    first.clear();
+    count.clear();
+
+    glm::vec4 planes[6];
+    GasketGeometry::frustumPlanes(projection * view, planes);
+
+    for (const Meshlet& meshlet : meshlets) {
+        if (GasketGeometry::outsideFrustum(planes, meshlet.Center, meshlet.Radius)) continue;
+
+        int start = static_cast<int>(meshlet.FirstVertex);
+        if (!first.empty() && first.back() + count.back() == start) {
+            count.back() += static_cast<int>(meshlet.VertexCount);
+        }
+        else {
+            first.push_back(start);
+            count.push_back(static_cast<int>(meshlet.VertexCount));
+        }
+    }
+}
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Bounds of one run of consecutive leaves of a Triangles level.
+// There is no normal cone: every leaf of every Fractal is closed (the tetra, cube and octahedron) or
+// two-sided (the triangle), so a meshlet always has front faces from any direction and a cone test
+// could never reject one.
+struct alignas(16) Meshlet {
+    glm::vec3 Center; // bounding sphere
+    float Radius;
+    glm::vec3 BoxMin;
+    uint32_t FirstVertex;
+    glm::vec3 BoxMax;
+    uint32_t VertexCount;
+};
+static_assert(sizeof(Meshlet) == 48, "three 16-byte rows per meshlet");
+
+// dividePyramid writes leaves depth first, so LeavesPerMeshlet consecutive leaves are one subtree
+// (for the tetrahedron, exactly the subtree at depth level - 3) and close together in space.
+// Per-frame passes then touch one Meshlet per 64 leaves instead of 768 vertices.
+namespace Meshlets {
+    constexpr int LeafLevels = 3;
+    constexpr size_t LeavesPerMeshlet = size_t(1) << (2 * LeafLevels); // 64
+
+    // From the vertices of any Triangles mesh, verticesPerMeshlet at a time (the last run may be short).
+    void build(const glm::vec3* positions, size_t vertexCount, size_t verticesPerMeshlet, std::vector<Meshlet>& meshlets,
+        ThreadPool* pool = nullptr);
+
+    // The gasket without reading a vertex: every leaf lies in the hull of its subtree's 4 corners.
+    void buildGasket(int level, std::vector<Meshlet>& meshlets);
+
+    // Meshlets inside the view frustum, as glMultiDrawArrays ranges;
+    // neighbours that are both visible are merged into one range.
+    void cull(const std::vector<Meshlet>& meshlets, const glm::mat4& view, const glm::mat4& projection,
+        std::vector<int>& first, std::vector<int>& count);
+}
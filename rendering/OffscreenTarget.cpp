@@ -0,0 +1,91 @@
+#include "OffscreenTarget.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    void checkComplete(GLuint framebuffer) {
+        if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("Offscreen framebuffer is incomplete");
+        }
+    }
+}
+
+void OffscreenTarget::create(int width, int height, int samples) {
+    if (width <= 0 || height <= 0) {
+        throw std::invalid_argument("Offscreen target needs a positive size");
+    }
+    release();
+
+    GLint maxSamples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    if (samples > maxSamples) {
+        std::cerr << "Warning: " << samples << "x MSAA is not supported, using " << maxSamples << "x" << std::endl;
+        samples = maxSamples;
+    }
+    Width = width;
+    Height = height;
+    Samples = samples > 1 ? samples : 0;
+
+    glCreateRenderbuffers(1, &Color);
+    glCreateRenderbuffers(1, &Depth);
+    glNamedRenderbufferStorageMultisample(Color, Samples, GL_RGBA8, Width, Height);
+    glNamedRenderbufferStorageMultisample(Depth, Samples, GL_DEPTH_COMPONENT24, Width, Height);
+    glCreateFramebuffers(1, &Framebuffer);
+    glNamedFramebufferRenderbuffer(Framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, Color);
+    glNamedFramebufferRenderbuffer(Framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, Depth);
+    checkComplete(Framebuffer);
+
+    if (Samples > 0) {
+        glCreateRenderbuffers(1, &ResolveColor);
+        glNamedRenderbufferStorage(ResolveColor, GL_RGBA8, Width, Height);
+        glCreateFramebuffers(1, &ResolveFramebuffer);
+        glNamedFramebufferRenderbuffer(ResolveFramebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ResolveColor);
+        checkComplete(ResolveFramebuffer);
+    }
+}
+
+void OffscreenTarget::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+    glViewport(0, 0, Width, Height);
+}
+
+void OffscreenTarget::read(RgbImage& image) const {
+    GLuint source = Framebuffer;
+    if (Samples > 0) {
+        glBlitNamedFramebuffer(Framebuffer, ResolveFramebuffer, 0, 0, Width, Height, 0, 0, Width, Height,
+            GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        source = ResolveFramebuffer;
+    }
+
+    image.Width = Width;
+    image.Height = Height;
+    image.Pixels.resize(size_t(3) * Width * Height);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, Width, Height, GL_RGB, GL_UNSIGNED_BYTE, image.Pixels.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, Framebuffer);
+
+    // GL rows start at the bottom
+    size_t rowBytes = size_t(3) * Width;
+    std::vector<uint8_t> row(rowBytes);
+    for (int y = 0; y < Height / 2; ++y) {
+        uint8_t* top = image.Pixels.data() + rowBytes * y;
+        uint8_t* bottom = image.Pixels.data() + rowBytes * (Height - 1 - y);
+        std::memcpy(row.data(), top, rowBytes);
+        std::memcpy(top, bottom, rowBytes);
+        std::memcpy(bottom, row.data(), rowBytes);
+    }
+}
+
+void OffscreenTarget::release() {
+    if (Framebuffer != 0) glDeleteFramebuffers(1, &Framebuffer);
+    if (ResolveFramebuffer != 0) glDeleteFramebuffers(1, &ResolveFramebuffer);
+    if (Color != 0) glDeleteRenderbuffers(1, &Color);
+    if (Depth != 0) glDeleteRenderbuffers(1, &Depth);
+    if (ResolveColor != 0) glDeleteRenderbuffers(1, &ResolveColor);
+    Framebuffer = Color = Depth = ResolveFramebuffer = ResolveColor = 0;
+    Width = Height = Samples = 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "ImageFile.h"
+
+// Color + depth framebuffer to render into without a window, multisampled like the window's
+// default framebuffer. read() resolves into a single-sampled copy and reads it back.
+// Needs the GL context for every call.
+class OffscreenTarget {
+public:
+    // samples is clamped to GL_MAX_SAMPLES; 0 or 1 renders single-sampled
+    void create(int width, int height, int samples);
+    void bind() const; // draw framebuffer and viewport
+    void read(RgbImage& image) const; // blocks until the frame is rendered
+    void release();
+
+    int width() const { return Width; }
+    int height() const { return Height; }
+    int samples() const { return Samples; }
+
+private:
+    GLuint Framebuffer = 0;
+    GLuint Color = 0;
+    GLuint Depth = 0;
+    GLuint ResolveFramebuffer = 0; // multisampled targets only
+    GLuint ResolveColor = 0;
+    int Width = 0;
+    int Height = 0;
+    int Samples = 0;
+};
@@ -0,0 +1,55 @@
+#include "RayMarchKernel.h"
+#include "RayMarchKernelMarch.h"
+
+namespace RayMarchKernel {
+
+namespace {
+    struct ScalarOps {
+        static constexpr int Width = 1;
+        using Reg = float;
+        using Mask = bool;
+        static Reg set1(float f) { return f; }
+        static Reg load(const float* p) { return *p; }
+        static void store(float* p, Reg r) { *p = r; }
+        static Reg add(Reg a, Reg b) { return a + b; }
+        static Reg sub(Reg a, Reg b) { return a - b; }
+        static Reg mul(Reg a, Reg b) { return a * b; }
+        static Reg div(Reg a, Reg b) { return a / b; }
+        static Reg min(Reg a, Reg b) { return a < b ? a : b; }
+        static Reg max(Reg a, Reg b) { return a < b ? b : a; }
+        static Mask less(Reg a, Reg b) { return a < b; }
+        static Mask equal(Reg a, Reg b) { return a == b; }
+        static Reg select(Mask m, Reg a, Reg b) { return m ? a : b; }
+        static Mask orMask(Mask a, Mask b) { return a || b; }
+        static Mask andNotMask(Mask a, Mask b) { return a && !b; }
+        static bool all(Mask m) { return m; }
+    };
+}
+
+void scalarKernel(const Scene& scene, RayPacket& packet) {
+    runKernel<ScalarOps>(scene, packet);
+}
+
+const char* isaName(Isa isa) {
+    return LeafKernel::isaName(isa);
+}
+
+Kernel kernel(Isa isa) {
+    if (static_cast<int>(isa) > static_cast<int>(LeafKernel::detectIsa())) return nullptr;
+
+    switch (isa) {
+#ifdef GASKET_X86_KERNELS
+    case Isa::SSE4: return sse4Kernel;
+    case Isa::AVX2: return avx2Kernel;
+    case Isa::AVX512: return avx512Kernel;
+#endif
+    default: return scalarKernel;
+    }
+}
+
+Kernel best() {
+    static const Kernel selected = RayMarchKernel::kernel(LeafKernel::detectIsa()); // not LeafKernel::kernel, found through Isa
+    return selected;
+}
+
+}
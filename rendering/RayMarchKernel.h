@@ -0,0 +1,57 @@
+#pragma once
+
+#include "LeafKernel.h"
+
+// SIMD sphere tracing of the tetrahedral IFS distance estimator, one packet of rays at a time.
+// Per-ISA units and runtime selection work exactly like LeafKernel, whose Isa detection is reused;
+// this header stays free of glm for the same reason.
+namespace RayMarchKernel {
+    using LeafKernel::Isa;
+
+    constexpr int PacketSize = 16; // one AVX-512 register, two AVX2 or four SSE4 lane groups
+
+    // The fractal, in floats. Each iteration folds a point towards its nearest corner and doubles it
+    // (z = 2z - corner), i.e. steps into the child nearest to it. That child alone can overshoot: a
+    // sibling's leaves may be closer. So every iteration also bounds the 3 siblings by the distance to
+    // their tetras (a plane distance each), and the estimate is the smallest of those bounds and the
+    // final tetra's, scaled back by 2^-level. It never exceeds the distance to the nearest leaf.
+    struct Scene {
+        float Corner[4][3];
+        float Normal[4][3];  // outward plane of the face opposite corner f
+        float Distance[4];   // the plane: dot(Normal[f], x) = Distance[f]
+        float Height[4];     // from face f to corner f; a child's face f sits Height[f] / 2 further in
+        int Iterations;
+        int MaxSteps;
+    };
+
+    // SoA rays with unit directions, marched from t = 0 up to TMax. A lane hits once the estimate
+    // drops below EpsilonBase + EpsilonSlope * t (about a pixel's footprint at that distance).
+    struct RayPacket {
+        alignas(64) float OriginX[PacketSize];
+        alignas(64) float OriginY[PacketSize];
+        alignas(64) float OriginZ[PacketSize];
+        alignas(64) float DirectionX[PacketSize];
+        alignas(64) float DirectionY[PacketSize];
+        alignas(64) float DirectionZ[PacketSize];
+        alignas(64) float TMax[PacketSize];
+        float EpsilonBase;
+        float EpsilonSlope;
+
+        // out: distance along the ray and the face hit (the corner it is opposite to), -1 for a miss
+        alignas(64) float T[PacketSize];
+        alignas(64) float Face[PacketSize];
+    };
+
+    using Kernel = void (*)(const Scene& scene, RayPacket& packet);
+
+    const char* isaName(Isa isa);
+    Kernel kernel(Isa isa);     // nullptr if that ISA is not available
+    Kernel best();              // kernel(LeafKernel::detectIsa()), resolved once
+
+    void scalarKernel(const Scene& scene, RayPacket& packet);
+#ifdef GASKET_X86_KERNELS
+    void sse4Kernel(const Scene& scene, RayPacket& packet);
+    void avx2Kernel(const Scene& scene, RayPacket& packet);
+    void avx512Kernel(const Scene& scene, RayPacket& packet);
+#endif
+}
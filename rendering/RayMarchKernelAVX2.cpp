@@ -0,0 +1,37 @@
+#include "RayMarchKernel.h"
+
+#ifdef GASKET_X86_KERNELS
+#include "RayMarchKernelMarch.h"
+#include <immintrin.h>
+
+namespace RayMarchKernel {
+
+namespace {
+    struct AVX2Ops {
+        static constexpr int Width = 8;
+        using Reg = __m256;
+        using Mask = __m256;
+        static Reg set1(float f) { return _mm256_set1_ps(f); }
+        static Reg load(const float* p) { return _mm256_load_ps(p); }
+        static void store(float* p, Reg r) { _mm256_store_ps(p, r); }
+        static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+        static Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+        static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+        static Reg div(Reg a, Reg b) { return _mm256_div_ps(a, b); }
+        static Reg min(Reg a, Reg b) { return _mm256_min_ps(a, b); }
+        static Reg max(Reg a, Reg b) { return _mm256_max_ps(a, b); }
+        static Mask less(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static Mask equal(Reg a, Reg b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+        static Reg select(Mask m, Reg a, Reg b) { return _mm256_blendv_ps(b, a, m); }
+        static Mask orMask(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+        static Mask andNotMask(Mask a, Mask b) { return _mm256_andnot_ps(b, a); }
+        static bool all(Mask m) { return _mm256_movemask_ps(m) == 0xFF; }
+    };
+}
+
+void avx2Kernel(const Scene& scene, RayPacket& packet) {
+    runKernel<AVX2Ops>(scene, packet);
+}
+
+}
+#endif
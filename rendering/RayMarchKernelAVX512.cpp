@@ -0,0 +1,37 @@
+#include "RayMarchKernel.h"
+
+#ifdef GASKET_X86_KERNELS
+#include "RayMarchKernelMarch.h"
+#include <immintrin.h>
+
+namespace RayMarchKernel {
+
+namespace {
+    struct AVX512Ops {
+        static constexpr int Width = 16;
+        using Reg = __m512;
+        using Mask = __mmask16;
+        static Reg set1(float f) { return _mm512_set1_ps(f); }
+        static Reg load(const float* p) { return _mm512_load_ps(p); }
+        static void store(float* p, Reg r) { _mm512_store_ps(p, r); }
+        static Reg add(Reg a, Reg b) { return _mm512_add_ps(a, b); }
+        static Reg sub(Reg a, Reg b) { return _mm512_sub_ps(a, b); }
+        static Reg mul(Reg a, Reg b) { return _mm512_mul_ps(a, b); }
+        static Reg div(Reg a, Reg b) { return _mm512_div_ps(a, b); }
+        static Reg min(Reg a, Reg b) { return _mm512_min_ps(a, b); }
+        static Reg max(Reg a, Reg b) { return _mm512_max_ps(a, b); }
+        static Mask less(Reg a, Reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+        static Mask equal(Reg a, Reg b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+        static Reg select(Mask m, Reg a, Reg b) { return _mm512_mask_blend_ps(m, b, a); }
+        static Mask orMask(Mask a, Mask b) { return static_cast<Mask>(a | b); }
+        static Mask andNotMask(Mask a, Mask b) { return static_cast<Mask>(a & ~b); }
+        static bool all(Mask m) { return m == 0xFFFF; }
+    };
+}
+
+void avx512Kernel(const Scene& scene, RayPacket& packet) {
+    runKernel<AVX512Ops>(scene, packet);
+}
+
+}
+#endif
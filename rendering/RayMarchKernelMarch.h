@@ -0,0 +1,139 @@
+#pragma once
+
+#include "RayMarchKernel.h"
+
+// Shared by every RayMarchKernel translation unit, with internal linkage like LeafKernelEmit.h.
+namespace RayMarchKernel {
+namespace {
+
+    // Ops supplies Width, Reg and Mask types, set1/load/store/add/sub/mul/div/min/max, less (a < b), equal,
+    // select(mask, a, b) (a where set), orMask, andNotMask (a and not b) and all(mask).
+    // There is no FMA (the ISA units are built without contraction), so every ISA gives the same image.
+
+    // the signed distances g[f] of (x, y, z) to the 4 face planes of the base tetra
+    template <typename Ops>
+    inline void planes(const Scene& scene, typename Ops::Reg x, typename Ops::Reg y, typename Ops::Reg z,
+        typename Ops::Reg (&g)[4]) {
+        for (int f = 0; f < 4; ++f) {
+            g[f] = Ops::sub(Ops::add(Ops::add(Ops::mul(x, Ops::set1(scene.Normal[f][0])),
+                Ops::mul(y, Ops::set1(scene.Normal[f][1]))), Ops::mul(z, Ops::set1(scene.Normal[f][2]))),
+                Ops::set1(scene.Distance[f]));
+        }
+    }
+
+    // step: no leaf is closer than this. leaf, face: the distance to the leaf the folds end in, and the
+    // face the ray enters it through; only this one can be a hit, since a sibling's tetra may be all holes.
+    // The entry face is the front face crossed last, the largest g[f] * entry[f] + back[f] (see runKernel).
+    template <typename Ops>
+    inline void estimate(const Scene& scene, typename Ops::Reg x, typename Ops::Reg y, typename Ops::Reg z,
+        const typename Ops::Reg (&entry)[4], const typename Ops::Reg (&back)[4],
+        typename Ops::Reg& step, typename Ops::Reg& leaf, typename Ops::Reg& face) {
+        using Reg = typename Ops::Reg;
+        using Mask = typename Ops::Mask;
+        const Reg two = Ops::set1(2.0f);
+        const Reg far = Ops::set1(3.0e38f);
+
+        step = far;
+        float scale = 1.0f;
+        for (int i = 0; i < scene.Iterations; ++i, scale *= 0.5f) {
+            // nearest corner
+            Reg cx = Ops::set1(scene.Corner[0][0]), cy = Ops::set1(scene.Corner[0][1]), cz = Ops::set1(scene.Corner[0][2]);
+            Reg dx = Ops::sub(x, cx), dy = Ops::sub(y, cy), dz = Ops::sub(z, cz);
+            Reg nearest = Ops::add(Ops::add(Ops::mul(dx, dx), Ops::mul(dy, dy)), Ops::mul(dz, dz));
+            Reg child = Ops::set1(0.0f);
+            for (int c = 1; c < 4; ++c) {
+                Reg kx = Ops::set1(scene.Corner[c][0]), ky = Ops::set1(scene.Corner[c][1]), kz = Ops::set1(scene.Corner[c][2]);
+                dx = Ops::sub(x, kx);
+                dy = Ops::sub(y, ky);
+                dz = Ops::sub(z, kz);
+                Reg d = Ops::add(Ops::add(Ops::mul(dx, dx), Ops::mul(dy, dy)), Ops::mul(dz, dz));
+                Mask closer = Ops::less(d, nearest);
+                nearest = Ops::select(closer, d, nearest);
+                child = Ops::select(closer, Ops::set1(static_cast<float>(c)), child);
+                cx = Ops::select(closer, kx, cx);
+                cy = Ops::select(closer, ky, cy);
+                cz = Ops::select(closer, kz, cz);
+            }
+
+            // the siblings: child c keeps the 3 planes through corner c and moves plane c in
+            Reg g[4];
+            planes<Ops>(scene, x, y, z, g);
+            for (int c = 0; c < 4; ++c) {
+                Reg bound = Ops::add(g[c], Ops::set1(0.5f * scene.Height[c]));
+                for (int f = 0; f < 4; ++f) {
+                    if (f != c) bound = Ops::max(bound, g[f]);
+                }
+                bound = Ops::select(Ops::equal(child, Ops::set1(static_cast<float>(c))), far, Ops::mul(bound, Ops::set1(scale)));
+                step = Ops::min(step, bound);
+            }
+
+            x = Ops::sub(Ops::mul(two, x), cx);
+            y = Ops::sub(Ops::mul(two, y), cy);
+            z = Ops::sub(Ops::mul(two, z), cz);
+        }
+
+        Reg g[4];
+        planes<Ops>(scene, x, y, z, g);
+        leaf = g[0];
+        face = Ops::set1(0.0f);
+        Reg latest = Ops::add(Ops::mul(g[0], entry[0]), back[0]);
+        for (int f = 1; f < 4; ++f) {
+            leaf = Ops::max(leaf, g[f]);
+            Reg crossing = Ops::add(Ops::mul(g[f], entry[f]), back[f]);
+            Mask later = Ops::less(latest, crossing);
+            latest = Ops::select(later, crossing, latest);
+            face = Ops::select(later, Ops::set1(static_cast<float>(f)), face);
+        }
+        leaf = Ops::mul(leaf, Ops::set1(scale));
+        step = Ops::min(step, leaf);
+    }
+
+    template <typename Ops>
+    inline void runKernel(const Scene& scene, RayPacket& packet) {
+        using Reg = typename Ops::Reg;
+        using Mask = typename Ops::Mask;
+        const Reg epsilonBase = Ops::set1(packet.EpsilonBase);
+        const Reg epsilonSlope = Ops::set1(packet.EpsilonSlope);
+        const Reg missed = Ops::set1(-1.0f);
+
+        for (int base = 0; base < PacketSize; base += Ops::Width) {
+            const Reg ox = Ops::load(packet.OriginX + base), oy = Ops::load(packet.OriginY + base), oz = Ops::load(packet.OriginZ + base);
+            const Reg dx = Ops::load(packet.DirectionX + base), dy = Ops::load(packet.DirectionY + base), dz = Ops::load(packet.DirectionZ + base);
+            const Reg tMax = Ops::load(packet.TMax + base);
+
+            // folds only translate and scale, so each face plane meets the ray at the same slope in every
+            // frame: g[f] / -dot(n, d) is how far back along the ray plane f was crossed; back faces never win
+            Reg entry[4], back[4];
+            for (int f = 0; f < 4; ++f) {
+                Reg slope = Ops::add(Ops::add(Ops::mul(dx, Ops::set1(scene.Normal[f][0])), Ops::mul(dy, Ops::set1(scene.Normal[f][1]))),
+                    Ops::mul(dz, Ops::set1(scene.Normal[f][2])));
+                Mask front = Ops::less(slope, Ops::set1(0.0f));
+                entry[f] = Ops::select(front, Ops::div(Ops::set1(-1.0f), slope), Ops::set1(0.0f));
+                back[f] = Ops::select(front, Ops::set1(0.0f), Ops::set1(-3.0e38f));
+            }
+
+            Reg t = Ops::set1(0.0f);
+            Reg hitFace = missed;
+            Mask done = Ops::less(t, t); // none
+            for (int i = 0; i < scene.MaxSteps; ++i) {
+                Reg step, leaf, face;
+                estimate<Ops>(scene, Ops::add(ox, Ops::mul(t, dx)), Ops::add(oy, Ops::mul(t, dy)), Ops::add(oz, Ops::mul(t, dz)),
+                    entry, back, step, leaf, face);
+
+                // at least epsilon per step: a sibling bound alone can shrink towards 0 without a leaf
+                // there, and skipping up to epsilon is what the hit test allows anyway
+                Reg epsilon = Ops::add(epsilonBase, Ops::mul(epsilonSlope, t));
+                Mask hit = Ops::andNotMask(Ops::less(leaf, epsilon), done);
+                hitFace = Ops::select(hit, face, hitFace);
+                done = Ops::orMask(done, hit);
+                t = Ops::select(done, t, Ops::add(t, Ops::max(step, epsilon)));
+                done = Ops::orMask(done, Ops::less(tMax, t));
+                if (Ops::all(done)) break;
+            }
+            Ops::store(packet.T + base, t);
+            Ops::store(packet.Face + base, hitFace);
+        }
+    }
+
+}
+}
@@ -0,0 +1,37 @@
+#include "RayMarchKernel.h"
+
+#ifdef GASKET_X86_KERNELS
+#include "RayMarchKernelMarch.h"
+#include <immintrin.h>
+
+namespace RayMarchKernel {
+
+namespace {
+    struct SSE4Ops {
+        static constexpr int Width = 4;
+        using Reg = __m128;
+        using Mask = __m128;
+        static Reg set1(float f) { return _mm_set1_ps(f); }
+        static Reg load(const float* p) { return _mm_load_ps(p); }
+        static void store(float* p, Reg r) { _mm_store_ps(p, r); }
+        static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+        static Reg sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+        static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+        static Reg div(Reg a, Reg b) { return _mm_div_ps(a, b); }
+        static Reg min(Reg a, Reg b) { return _mm_min_ps(a, b); }
+        static Reg max(Reg a, Reg b) { return _mm_max_ps(a, b); }
+        static Mask less(Reg a, Reg b) { return _mm_cmplt_ps(a, b); }
+        static Mask equal(Reg a, Reg b) { return _mm_cmpeq_ps(a, b); }
+        static Reg select(Mask m, Reg a, Reg b) { return _mm_blendv_ps(b, a, m); }
+        static Mask orMask(Mask a, Mask b) { return _mm_or_ps(a, b); }
+        static Mask andNotMask(Mask a, Mask b) { return _mm_andnot_ps(b, a); }
+        static bool all(Mask m) { return _mm_movemask_ps(m) == 0xF; }
+    };
+}
+
+void sse4Kernel(const Scene& scene, RayPacket& packet) {
+    runKernel<SSE4Ops>(scene, packet);
+}
+
+}
+#endif
@@ -0,0 +1,126 @@
+#include "RayMarcher.h"
+#include "BuildProgress.h"
+#include "GasketGeometry.h"
+#include "../core/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace RayMarcher {
+
+namespace {
+    RayMarchKernel::Scene makeScene(const Settings& settings) {
+        const RayTracer::BasePlanes& planes = RayTracer::basePlanes();
+        RayMarchKernel::Scene scene;
+        for (int i = 0; i < 4; ++i) {
+            const glm::vec3& corner = GasketGeometry::baseVertices[i];
+            scene.Corner[i][0] = corner.x;
+            scene.Corner[i][1] = corner.y;
+            scene.Corner[i][2] = corner.z;
+            for (int axis = 0; axis < 3; ++axis) scene.Normal[i][axis] = static_cast<float>(planes.Normal[i][axis]);
+            scene.Distance[i] = static_cast<float>(planes.Distance[i]);
+            scene.Height[i] = static_cast<float>(planes.Height[i]);
+        }
+        scene.Iterations = settings.Iterations;
+        scene.MaxSteps = settings.MaxSteps;
+        return scene;
+    }
+}
+
+RayTracer::Stats render(const Settings& settings, const glm::mat4& view, const glm::mat4& projection, int width,
+    int height, RgbImage& image, ThreadPool* pool, BuildProgress* progress, RayMarchKernel::Kernel kernel) {
+    if (settings.Iterations < 0 || settings.Iterations > MaxIterations) {
+        throw std::invalid_argument("Ray march iterations out of range: " + std::to_string(settings.Iterations));
+    }
+    if (width <= 0 || height <= 0) throw std::invalid_argument("Image size must be positive");
+    if (!kernel) kernel = RayMarchKernel::best();
+
+    image.Width = width;
+    image.Height = height;
+    image.Pixels.assign(size_t(3) * width * height, 255);
+
+    const RayTracer::PixelRays rays(view, projection, width, height);
+    const int tilesX = (width + RayTracer::TileSize - 1) / RayTracer::TileSize;
+    const int tilesY = (height + RayTracer::TileSize - 1) / RayTracer::TileSize;
+    const size_t tiles = size_t(tilesX) * tilesY;
+    if (progress) progress->Total = tiles;
+
+    // the gap between neighbouring pixel rays, at the near and far planes: the hit epsilon in between
+    // follows it linearly, so it is constant for an orthographic camera
+    glm::dvec3 origin, direction, nextOrigin, nextDirection;
+    rays.ray(width / 2, height / 2, origin, direction);
+    rays.ray(width / 2 + 1, height / 2, nextOrigin, nextDirection);
+    double nearGap = glm::length(nextOrigin - origin);
+    double farGap = glm::length((nextOrigin + nextDirection) - (origin + direction));
+    double length = glm::length(direction);
+
+    // Folds past the level where a leaf edge (2^-level) drops below the hit epsilon change nothing
+    // visible, so deep levels stop there; the epsilon is taken where the gasket's bounding sphere
+    // is nearest to the camera, the finest any ray needs.
+    RayMarchKernel::Scene scene = makeScene(settings);
+    glm::dvec3 center(0.0);
+    for (const glm::vec3& corner : GasketGeometry::baseVertices) center += glm::dvec3(corner.x, corner.y, corner.z) * 0.25;
+    double radius = glm::length(glm::dvec3(GasketGeometry::baseVertices[0].x, GasketGeometry::baseVertices[0].y,
+        GasketGeometry::baseVertices[0].z) - center);
+    double nearest = std::max(0.0, glm::length(center - origin) - radius);
+    double finest = settings.EpsilonPixels * (nearGap + (farGap - nearGap) * nearest / length);
+    if (finest > 0.0) {
+        int visible = static_cast<int>(std::ceil(std::log2(1.0 / finest))) + 1;
+        scene.Iterations = std::min(scene.Iterations, std::max(visible, 0));
+    }
+
+    auto tile = [&](size_t index) {
+        RayMarchKernel::RayPacket packet;
+        packet.EpsilonBase = static_cast<float>(settings.EpsilonPixels * nearGap);
+        packet.EpsilonSlope = static_cast<float>(settings.EpsilonPixels * (farGap - nearGap) / length);
+
+        int x0 = static_cast<int>(index % tilesX) * RayTracer::TileSize;
+        int y0 = static_cast<int>(index / tilesX) * RayTracer::TileSize;
+        int x1 = std::min(x0 + RayTracer::TileSize, width);
+        for (int y = y0; y < std::min(y0 + RayTracer::TileSize, height); ++y) {
+            for (int x = x0; x < x1; x += RayMarchKernel::PacketSize) {
+                // a short run at the image edge repeats its last pixel in the spare lanes
+                int count = std::min(RayMarchKernel::PacketSize, x1 - x);
+                for (int lane = 0; lane < RayMarchKernel::PacketSize; ++lane) {
+                    glm::dvec3 o, d;
+                    rays.ray(x + std::min(lane, count - 1), y, o, d);
+                    double tMax = glm::length(d);
+                    d = d * (1.0 / tMax);
+                    packet.OriginX[lane] = static_cast<float>(o.x);
+                    packet.OriginY[lane] = static_cast<float>(o.y);
+                    packet.OriginZ[lane] = static_cast<float>(o.z);
+                    packet.DirectionX[lane] = static_cast<float>(d.x);
+                    packet.DirectionY[lane] = static_cast<float>(d.y);
+                    packet.DirectionZ[lane] = static_cast<float>(d.z);
+                    packet.TMax[lane] = static_cast<float>(tMax);
+                }
+
+                kernel(scene, packet);
+
+                for (int lane = 0; lane < count; ++lane) {
+                    int face = static_cast<int>(packet.Face[lane]);
+                    if (face >= 0) RayTracer::shade(face, &image.Pixels[3 * (size_t(y) * width + x + lane)]);
+                }
+            }
+        }
+        if (progress) progress->advance(1);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    if (pool && tiles > 1) {
+        pool->parallelFor(tiles, tile);
+    }
+    else {
+        for (size_t i = 0; i < tiles; ++i) tile(i);
+    }
+
+    RayTracer::Stats stats;
+    stats.Rays = uint64_t(width) * height;
+    stats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "ImageFile.h"
+#include "RayMarchKernel.h"
+#include "RayTracer.h"
+
+class ThreadPool;
+struct BuildProgress;
+
+// The other CPU renderer: sphere tracing of a distance estimator for the tetrahedral IFS
+// (RayMarchKernel.h), PacketSize rays at a time in SIMD lanes. Memory stays constant and each
+// iteration is one more level, at the cost of an approximate surface: a hit is anything closer
+// than EpsilonPixels pixel footprints, so features below a pixel merge instead of aliasing.
+// Same camera rays, tiles and face colors as RayTracer, so the two images can be compared.
+namespace RayMarcher {
+    constexpr int MaxIterations = 40; // past ~24 folds float positions stop resolving new detail anyway
+
+    struct Settings {
+        int Iterations = 12;
+        float EpsilonPixels = 0.5f; // grows with distance under a perspective projection
+        int MaxSteps = 256;
+    };
+
+    // kernel: nullptr = RayMarchKernel::best(). Progress counts tiles; throws past MaxIterations.
+    RayTracer::Stats render(const Settings& settings, const glm::mat4& view, const glm::mat4& projection, int width,
+        int height, RgbImage& image, ThreadPool* pool = nullptr, BuildProgress* progress = nullptr,
+        RayMarchKernel::Kernel kernel = nullptr);
+}
@@ -0,0 +1,194 @@
+#include "RayTracer.h"
+#include "BuildProgress.h"
+#include "GasketGeometry.h"
+#include "../core/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace RayTracer {
+
+BasePlanes::BasePlanes() {
+    const glm::vec3* b = GasketGeometry::baseVertices;
+    glm::dvec3 v[4];
+    for (int i = 0; i < 4; ++i) v[i] = glm::dvec3(b[i].x, b[i].y, b[i].z);
+    for (int f = 0; f < 4; ++f) {
+        const glm::dvec3& p0 = v[(f + 1) % 4];
+        glm::dvec3 n = glm::normalize(glm::cross(v[(f + 2) % 4] - p0, v[(f + 3) % 4] - p0));
+        if (glm::dot(n, v[f] - p0) > 0.0) n = -n; // outward, away from the opposite corner
+        Normal[f] = n;
+        Distance[f] = glm::dot(n, p0);
+        Height[f] = Distance[f] - glm::dot(n, v[f]);
+    }
+}
+
+const BasePlanes& basePlanes() {
+    static const BasePlanes planes;
+    return planes;
+}
+
+namespace {
+    // A node relative to one ray: Plane[f] = Distance[f] * scale + dot(Normal[f], offset - origin),
+    // so the node contains origin + t * direction where t * Slope[f] <= Plane[f] for every face.
+    struct Node {
+        double Plane[4];
+        double Near;
+        int Face;
+        int Depth;
+    };
+
+    // [Near, far] of the ray inside the node, clipped to [0, tMax]; false if empty
+    bool clip(Node& node, const double (&slope)[4], double tMax) {
+        double near = 0.0, far = tMax;
+        int face = -1;
+        for (int f = 0; f < 4; ++f) {
+            if (slope[f] > 0.0) {
+                far = std::min(far, node.Plane[f] / slope[f]);
+            }
+            else if (slope[f] < 0.0) {
+                double t = node.Plane[f] / slope[f];
+                if (t > near) {
+                    near = t;
+                    face = f;
+                }
+            }
+            else if (node.Plane[f] < 0.0) {
+                return false;
+            }
+        }
+        node.Near = near;
+        node.Face = face;
+        return near <= far;
+    }
+}
+
+void shade(int face, uint8_t* pixel) {
+    const glm::vec3& c = GasketGeometry::faceColors[basePlanes().Color[face]];
+    pixel[0] = static_cast<uint8_t>(std::lround(c.x * 255.0f));
+    pixel[1] = static_cast<uint8_t>(std::lround(c.y * 255.0f));
+    pixel[2] = static_cast<uint8_t>(std::lround(c.z * 255.0f));
+}
+
+PixelRays::PixelRays(const glm::mat4& view, const glm::mat4& projection, int width, int height)
+    : Width(width), Height(height) {
+    glm::mat4 inverse = glm::inverse(projection * view);
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) Inverse[c][r] = inverse[c][r];
+    }
+}
+
+glm::dvec3 PixelRays::unproject(double x, double y, double z) const {
+    double p[4];
+    for (int r = 0; r < 4; ++r) p[r] = Inverse[0][r] * x + Inverse[1][r] * y + Inverse[2][r] * z + Inverse[3][r];
+    return glm::dvec3(p[0] / p[3], p[1] / p[3], p[2] / p[3]);
+}
+
+void PixelRays::ray(double x, double y, glm::dvec3& origin, glm::dvec3& direction) const {
+    double ndcX = 2.0 * (x + 0.5) / Width - 1.0;
+    double ndcY = 1.0 - 2.0 * (y + 0.5) / Height;
+    origin = unproject(ndcX, ndcY, -1.0);
+    direction = unproject(ndcX, ndcY, 1.0) - origin;
+}
+
+bool intersect(int level, const glm::dvec3& origin, const glm::dvec3& direction, double tMax, double& t, int& face) {
+    const BasePlanes& base = basePlanes();
+    double slope[4];
+    Node stack[3 * MaxLevel + 1];
+    int top = 0;
+
+    Node& root = stack[top];
+    for (int f = 0; f < 4; ++f) {
+        slope[f] = glm::dot(base.Normal[f], direction);
+        root.Plane[f] = base.Distance[f] - glm::dot(base.Normal[f], origin);
+    }
+    root.Depth = 0;
+    if (!clip(root, slope, tMax)) return false;
+    ++top;
+
+    double best = tMax;
+    face = -1;
+    while (top > 0) {
+        const Node node = stack[--top];
+        if (node.Near >= best) continue;
+
+        if (node.Depth == level) {
+            if (node.Face >= 0) {
+                best = node.Near;
+                face = node.Face;
+            }
+            continue;
+        }
+
+        // the 4 children, pushed farthest first so the nearest is walked next
+        double half = std::ldexp(0.5, -node.Depth);
+        Node children[4];
+        int count = 0;
+        for (int c = 0; c < 4; ++c) {
+            Node& child = children[count];
+            for (int f = 0; f < 4; ++f) child.Plane[f] = node.Plane[f];
+            child.Plane[c] -= half * base.Height[c];
+            child.Depth = node.Depth + 1;
+            if (clip(child, slope, best)) ++count;
+        }
+        std::sort(children, children + count, [](const Node& a, const Node& b) { return a.Near > b.Near; });
+        for (int i = 0; i < count; ++i) stack[top++] = children[i];
+    }
+
+    if (face < 0) return false;
+    t = best;
+    return true;
+}
+
+Stats render(int level, const glm::mat4& view, const glm::mat4& projection, int width, int height, RgbImage& image,
+    ThreadPool* pool, BuildProgress* progress) {
+    if (level < 0 || level > MaxLevel) {
+        throw std::invalid_argument("Ray traced level out of range: " + std::to_string(level));
+    }
+    if (width <= 0 || height <= 0) throw std::invalid_argument("Image size must be positive");
+
+    image.Width = width;
+    image.Height = height;
+    image.Pixels.assign(size_t(3) * width * height, 255);
+
+    const PixelRays rays(view, projection, width, height);
+    const int tilesX = (width + TileSize - 1) / TileSize;
+    const int tilesY = (height + TileSize - 1) / TileSize;
+    const size_t tiles = size_t(tilesX) * tilesY;
+    if (progress) progress->Total = tiles;
+
+    auto tile = [&](size_t index) {
+        int x0 = static_cast<int>(index % tilesX) * TileSize;
+        int y0 = static_cast<int>(index / tilesX) * TileSize;
+        for (int y = y0; y < std::min(y0 + TileSize, height); ++y) {
+            for (int x = x0; x < std::min(x0 + TileSize, width); ++x) {
+                glm::dvec3 origin, direction;
+                rays.ray(x, y, origin, direction);
+                double t;
+                int face;
+                if (intersect(level, origin, direction, 1.0, t, face)) {
+                    shade(face, &image.Pixels[3 * (size_t(y) * width + x)]);
+                }
+            }
+        }
+        if (progress) progress->advance(1);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    if (pool && tiles > 1) {
+        pool->parallelFor(tiles, tile);
+    }
+    else {
+        for (size_t i = 0; i < tiles; ++i) tile(i);
+    }
+
+    Stats stats;
+    stats.Rays = uint64_t(width) * height;
+    stats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+}
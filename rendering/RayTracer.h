@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+#include "ImageFile.h"
+
+class ThreadPool;
+struct BuildProgress;
+
+// Renders the gasket on the CPU, for machines without a GL 4.5 context. Rays are intersected with
+// the tetra hierarchy itself, walked front to back from the root, so nothing is generated or stored
+// and the level is only limited by double precision. The hierarchy needs no BVH: every node is a
+// tetra that contains its children, and child c is its parent with the plane opposite corner c
+// moved halfway in, so a child's 4 plane distances cost one subtraction.
+// The image matches the GL renderer: flat face colors on white, one ray through each pixel center.
+namespace RayTracer {
+    constexpr int MaxLevel = 30;
+    constexpr int TileSize = 32; // pixels per side of the unit of work handed to the pool
+
+    // the base tetra as 4 half spaces dot(Normal[f], x) <= Distance[f], face f opposite corner f
+    struct BasePlanes {
+        BasePlanes();
+
+        glm::dvec3 Normal[4];
+        double Distance[4];
+        double Height[4]; // from face f to corner f
+        // index into faceColors as emitTetra colors the face: red (0, 1, 2), black (3, 2, 1),
+        // blue (0, 3, 1), green (0, 2, 3)
+        int Color[4] = { 3, 1, 2, 0 };
+    };
+    const BasePlanes& basePlanes();
+
+    // the RGB8 color of face f, as the GL renderer draws it
+    void shade(int face, uint8_t* pixel);
+
+    // The ray through the center of pixel (x, y), top row first: from the near plane (t = 0) to the
+    // far plane (t = 1), where the GL depth test would clip. Unprojected in doubles, for any zoom.
+    class PixelRays {
+    public:
+        PixelRays(const glm::mat4& view, const glm::mat4& projection, int width, int height);
+        void ray(double x, double y, glm::dvec3& origin, glm::dvec3& direction) const;
+
+    private:
+        glm::dvec3 unproject(double x, double y, double z) const;
+
+        double Inverse[4][4]; // inverse(projection * view), column major
+        int Width;
+        int Height;
+    };
+
+    struct Stats {
+        uint64_t Rays = 0;
+        double Seconds = 0.0;
+
+        double megaRaysPerSecond() const { return Seconds > 0.0 ? Rays / Seconds * 1e-6 : 0.0; }
+    };
+
+    // Nearest leaf of the given level along origin + t * direction, 0 <= t <= tMax. face is the
+    // corner the hit face is opposite to, as an index into baseVertices. Faces seen from inside
+    // (the ray starts in a leaf) are skipped, like GL back-face culling.
+    bool intersect(int level, const glm::dvec3& origin, const glm::dvec3& direction, double tMax, double& t, int& face);
+
+    // Whole image, tiles spread over the pool. Progress counts tiles; throws past MaxLevel.
+    Stats render(int level, const glm::mat4& view, const glm::mat4& projection, int width, int height, RgbImage& image,
+        ThreadPool* pool = nullptr, BuildProgress* progress = nullptr);
+}
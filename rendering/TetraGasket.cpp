@@ -1,23 +1,36 @@
 #include "TetraGasket.h"
+#include "BakedGasket.h"
+#include "ChunkedGeometry.h"
+#include "GasketGeometry.h"
+#include "IfsRules.h"
+#include "LatticeGeometry.h"
+#include "MeshFile.h"
+#include "Meshlets.h"
+#include "../core/ThreadPool.h"
+#include "../core/Trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+void TetraGasket::init(const Shader& shader) {
+    ScaleLocation = shader.location("Scale");
+    LatticeScaleLocation = shader.location("LatticeScale");
+    LevelLocation = shader.location("Level");
+
+    // constant for the program's whole life, so set once instead of every draw
+    glProgramUniform3fv(shader.ID, shader.location("BaseVertices"), 4, &GasketGeometry::baseVertices[0].x);
+    glProgramUniform3fv(shader.ID, shader.location("FaceColors"), 4, &GasketGeometry::faceColors[0].x);
 
-static const glm::vec3 baseVertices[4] = {
-    glm::vec3(0.0f, 0.0f, sqrt(6.0f) / 4.0f),                   // v[0]
-    glm::vec3(0.0f, sqrt(3.0f) / 3.0f, sqrt(6.0f) / 12.0f),     // v[1]
-    glm::vec3(-0.5f, -sqrt(3.0f) / 6.0, sqrt(6.0f) / 12.0f),    // v[2]
-    glm::vec3(0.5f, -sqrt(3.0f) / 6.0, sqrt(6.0f) / 12.0f)      // v[3]
-};
-
-static const glm::vec3 faceColors[4] = {
-    glm::vec3(1.0f, 0.0f, 0.0f), // Red
-    glm::vec3(0.0, 1.0, 0.0),    // Green
-    glm::vec3(0.0f, 0.0f, 1.0f), // Blue
-    glm::vec3(0.0f, 0.0f, 0.0f)  // Black
-};
-
-void TetraGasket::init() {
     glCreateVertexArrays(1, &VAO);
-    glCreateBuffers(1, &VBO_Position);
-    glCreateBuffers(1, &VBO_Color);
 
     // Position (Loc 0)
     glEnableVertexArrayAttrib(VAO, 0);
@@ -29,71 +42,791 @@ void TetraGasket::init() {
     glVertexArrayAttribFormat(VAO, 1, 3, GL_FLOAT, GL_FALSE, 0);
     glVertexArrayAttribBinding(VAO, 1, 1);
 
-	// Bind VBOs to VAO
-    glVertexArrayVertexBuffer(VAO, 0, VBO_Position, 0, sizeof(glm::vec3));
-    glVertexArrayVertexBuffer(VAO, 1, VBO_Color, 0, sizeof(glm::vec3));
+    // Per-instance offset (Loc 2), enabled in Instanced mode only.
+    // While disabled the shader reads the default (0, 0, 0).
+    glVertexArrayAttribFormat(VAO, 2, 3, GL_FLOAT, GL_FALSE, 0);
+    glVertexArrayAttribBinding(VAO, 2, 2);
+    glVertexArrayBindingDivisor(VAO, 2, 1);
+
+    // Palette index (Loc 3), Lattice16 vertices only
+    glVertexArrayAttribIFormat(VAO, 3, 1, GL_UNSIGNED_SHORT, offsetof(VertexPacking::Lattice16Vertex, palette));
+    glVertexArrayAttribBinding(VAO, 3, 0);
+
+    // the buffers belong to each cached level and are bound to the VAO in configureAttributes()
+}
+
+TetraGasket::PendingBuild::~PendingBuild() {
+    if (Thread.joinable()) {
+        Progress.Cancelled = true;
+        Thread.join();
+    }
+}
+
+std::unique_ptr<GasketLevel> TetraGasket::newLevel(int level) const {
+    // the other shapes only exist as plain triangles, and their vertices are off the tetra lattice
+    bool tetra = (Shape == Fractal::Tetrahedron);
+    GasketMode mode = tetra ? Mode : GasketMode::Triangles;
+    VertexFormat format = (!tetra && Format == VertexFormat::Lattice16) ? VertexFormat::Float32 : Format;
+
+    // compact formats only apply to the per-vertex data of Triangles and Indexed,
+    // and LOD does not depend on the level at all
+    bool perVertex = (mode == GasketMode::Triangles || mode == GasketMode::Indexed);
+
+    std::unique_ptr<GasketLevel> fresh = std::make_unique<GasketLevel>();
+    fresh->Shape = Shape;
+    fresh->Mode = mode;
+    fresh->Format = perVertex ? format : VertexFormat::Float32;
+    fresh->Level = (mode == GasketMode::Lod) ? 0 : level;
+    return fresh;
+}
+
+GasketLevel* TetraGasket::refinementSource(const GasketLevel& out) {
+    // the level above, cached in any format, can be split once instead of walking down from the root
+    bool refinable = out.Shape == Fractal::Tetrahedron
+        && (out.Mode == GasketMode::Triangles || out.Mode == GasketMode::Instanced);
+    if (!refinable || out.Level == 0) return nullptr;
+
+    // levels built on the Mapped path kept no CPU copy to read back
+    GasketLevel* parent = Cache.findLevel(out.Shape, out.Mode, out.Level - 1);
+    bool readable = parent && (out.Mode == GasketMode::Triangles ? !parent->Positions.empty() : !parent->Offsets.empty());
+    return readable ? parent : nullptr;
+}
+
+void TetraGasket::mapStorage(GasketLevel& out) {
+    if (Upload != UploadPath::Mapped) return;
+
+    // only streams whose size is known before the build can be written in place;
+    // Indexed learns its vertex count from the dedup, and the rest is a few hundred bytes
+    out.createBuffers();
+    if (out.Mode == GasketMode::Triangles) {
+        size_t vertices = Ifs::vertexCount(out.Shape, out.Level);
+        if (out.Format == VertexFormat::Float32) {
+            out.MappedPosition = out.mapStorage(GasketLevel::PositionStream, vertices * sizeof(glm::vec3));
+            out.MappedColor = out.mapStorage(GasketLevel::ColorStream, vertices * sizeof(glm::vec3));
+        }
+        else {
+            out.MappedPosition = out.mapStorage(GasketLevel::PositionStream, vertices * VertexPacking::stride(out.Format));
+        }
+    }
+    else if (out.Mode == GasketMode::Instanced) {
+        out.MappedOffset = out.mapStorage(GasketLevel::OffsetStream, GasketGeometry::tetraCount(out.Level) * sizeof(glm::vec3));
+    }
+}
+
+void TetraGasket::generate(int level, ThreadPool* pool) {
+    TRACE_ZONE("TetraGasket::generate");
+    cancelBuild();
+    ChunkPool = pool;
+    activate(buildNow(level, pool));
+}
+
+void TetraGasket::preload(int level, ThreadPool* pool) {
+    cancelBuild();
+    buildNow(level, pool);
+    Cache.trim(Current);
+}
+
+GasketLevel* TetraGasket::buildNow(int level, ThreadPool* pool) {
+    std::unique_ptr<GasketLevel> fresh = newLevel(level);
+    GasketLevel* entry = Cache.find(fresh->Shape, fresh->Mode, fresh->Format, fresh->Level);
+    if (!entry) {
+        mapStorage(*fresh);
+        produceLevel(*fresh, refinementSource(*fresh), pool, nullptr, DiskCache);
+        beginUpload(std::move(fresh));
+        uploadSome(~size_t(0));
+        entry = Cache.insert(std::move(Uploading));
+    }
+    return entry;
+}
+
+void TetraGasket::generateAsync(int level, ThreadPool* pool) {
+    ChunkPool = pool;
+    std::unique_ptr<GasketLevel> fresh = newLevel(level);
+    if (pending(*fresh)) return; // already on its way
+
+    // a different level was picked mid-build: drop the old one without waiting for it,
+    // the current level keeps drawing meanwhile
+    Queued.reset();
+    Uploading.reset();
+    if (Building) Building->Progress.Cancelled = true;
+
+    if (GasketLevel* entry = Cache.find(fresh->Shape, fresh->Mode, fresh->Format, fresh->Level)) {
+        activate(entry);
+        return;
+    }
+
+    // the cancelled build still owns the pool until it notices; start once it has
+    if (Building) {
+        Queued = std::move(fresh);
+        QueuedPool = pool;
+        return;
+    }
+    startBuild(std::move(fresh), pool);
+}
+
+void TetraGasket::startBuild(std::unique_ptr<GasketLevel> level, ThreadPool* pool) {
+    std::unique_ptr<PendingBuild> build = std::make_unique<PendingBuild>();
+    mapStorage(*level);
+    build->Source = refinementSource(*level);
+    if (build->Source) build->Source->Pinned = true;
+    build->Progress.Total = buildUnits(*level);
+    build->Result = std::move(level);
+
+    PendingBuild* job = build.get();
+    job->Thread = std::thread([job, pool, diskCache = DiskCache]() {
+        TRACE_THREAD("Level build");
+        try {
+            produceLevel(*job->Result, job->Source, pool, &job->Progress, diskCache);
+        }
+        catch (...) {
+            job->Error = std::current_exception();
+        }
+        job->Finished.store(true, std::memory_order_release);
+    });
+    Building = std::move(build);
+}
+
+void TetraGasket::update() {
+    if (Building && Building->Finished.load(std::memory_order_acquire)) {
+        std::unique_ptr<PendingBuild> done = std::move(Building);
+        done->Thread.join();
+        if (done->Source) done->Source->Pinned = false;
+
+        if (!done->Progress.Cancelled) {
+            // a failed build (out of memory at a deep level, an unreadable cache file) is reported,
+            // and the current level keeps drawing
+            if (done->Error) {
+                try {
+                    std::rethrow_exception(done->Error);
+                }
+                catch (const std::bad_alloc&) {
+                    BuildError = "out of memory building level " + std::to_string(done->Result->Level);
+                }
+                catch (const std::exception& e) {
+                    BuildError = e.what();
+                }
+            }
+            else {
+                beginUpload(std::move(done->Result));
+            }
+        }
+        else if (Queued) {
+            startBuild(std::move(Queued), QueuedPool);
+        }
+    }
+
+    // a slice of the upload per frame keeps the driver copy from stalling the frame
+    if (Uploading && uploadSome(UploadBytesPerFrame)) {
+        activate(Cache.insert(std::move(Uploading)));
+    }
+}
+
+const char* TetraGasket::buildStage() const {
+    if (Queued || (Building && Building->Progress.Cancelled)) return "Cancelling";
+    if (Building) return "Generating";
+    if (Uploading) return "Uploading";
+    if (Current && Current->Chunks && Current->Chunks->missingCount() > 0) return "Streaming";
+    return nullptr;
+}
+
+float TetraGasket::buildProgress() const {
+    if (Queued) return 0.0f;
+    if (Building) return Building->Progress.fraction();
+    if (Uploading && UploadTotalBytes > 0) return static_cast<float>(UploadedBytes) / static_cast<float>(UploadTotalBytes);
+    if (Current && Current->Chunks && Current->Chunks->visibleCount() > 0) {
+        const ChunkedGeometry& chunks = *Current->Chunks;
+        return 1.0f - static_cast<float>(chunks.missingCount()) / static_cast<float>(chunks.visibleCount());
+    }
+    return 1.0f;
+}
+
+bool TetraGasket::pending(const GasketLevel& level) const {
+    const GasketLevel* next = Uploading.get();
+    if (Queued) next = Queued.get();
+    else if (Building && !Building->Progress.Cancelled) next = Building->Result.get();
+    return next && next->Shape == level.Shape && next->Mode == level.Mode && next->Format == level.Format
+        && next->Level == level.Level;
+}
+
+void TetraGasket::cancelBuild() {
+    if (Building) {
+        // the build checks the flag between slices, but may be inside an allocation
+        Building->Progress.Cancelled = true;
+        Building->Thread.join();
+        if (Building->Source) Building->Source->Pinned = false;
+        Building.reset();
+    }
+    Queued.reset();
+    Uploading.reset();
+}
+
+void TetraGasket::activate(GasketLevel* entry) {
+    // switching to a cached level is only a rebind of its buffers
+    Current = entry;
+    if (entry->Mode == GasketMode::Lod) LodDirty = true;
+    MeshletsDirty = true;
+    if (entry->Mode == GasketMode::Chunked && !entry->Chunks) {
+        entry->Chunks = std::make_unique<ChunkedGeometry>(entry->Level, ChunkBudget);
+    }
+    LodRingBound = false;
+    configureAttributes();
+    Cache.trim(Current);
+}
+
+void TetraGasket::setCacheBudget(size_t bytes) {
+    Cache.setBudget(bytes);
+    Cache.trim(Current);
+}
+
+void TetraGasket::setChunkBudget(size_t bytes) {
+    if (bytes == ChunkBudget) return;
+    ChunkBudget = bytes;
+
+    // the slots are sized once, so the level being drawn starts over; cached ones keep their size
+    if (Current && Current->Chunks) {
+        Current->Chunks = std::make_unique<ChunkedGeometry>(Current->Level, ChunkBudget);
+        configureAttributes();
+        Cache.trim(Current);
+    }
+}
+
+void TetraGasket::configureAttributes() {
+    const GasketLevel& entry = *Current;
+    GasketMode mode = entry.Mode;
+    VertexFormat format = entry.Format;
+
+    if (format == VertexFormat::Snorm16) {
+        // one interleaved stream: normalized shorts + RGBA8
+        glVertexArrayAttribFormat(VAO, 0, 3, GL_SHORT, GL_TRUE, offsetof(VertexPacking::Snorm16Vertex, x));
+        glVertexArrayAttribFormat(VAO, 1, 3, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(VertexPacking::Snorm16Vertex, r));
+        glVertexArrayAttribBinding(VAO, 1, 0);
+        glVertexArrayVertexBuffer(VAO, 0, entry.VBO_Position, 0, sizeof(VertexPacking::Snorm16Vertex));
+    }
+    else if (format == VertexFormat::Lattice16) {
+        // one interleaved stream: integer lattice coordinates, converted in the shader, + palette index
+        glVertexArrayAttribFormat(VAO, 0, 3, GL_UNSIGNED_SHORT, GL_FALSE, offsetof(VertexPacking::Lattice16Vertex, k1));
+        glVertexArrayVertexBuffer(VAO, 0, entry.VBO_Position, 0, sizeof(VertexPacking::Lattice16Vertex));
+    }
+    else {
+        // Chunked keeps its streams in the chunk slots
+        GLuint positions = entry.Chunks ? entry.Chunks->positionBuffer() : entry.VBO_Position;
+        GLuint colors = entry.Chunks ? entry.Chunks->colorBuffer() : entry.VBO_Color;
+        glVertexArrayAttribFormat(VAO, 0, 3, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribFormat(VAO, 1, 3, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(VAO, 1, 1);
+        glVertexArrayVertexBuffer(VAO, 0, positions, 0, sizeof(glm::vec3));
+        glVertexArrayVertexBuffer(VAO, 1, colors, 0, sizeof(glm::vec3));
+    }
+
+    // only used by glDrawElements in Indexed mode
+    glVertexArrayElementBuffer(VAO, entry.EBO);
+
+    // Procedural mode reads no attributes at all, only Instanced reads the offsets
+    if (mode == GasketMode::Procedural) {
+        glDisableVertexArrayAttrib(VAO, 0);
+    }
+    else {
+        glEnableVertexArrayAttrib(VAO, 0);
+    }
+    if (mode == GasketMode::Procedural || format == VertexFormat::Lattice16) {
+        glDisableVertexArrayAttrib(VAO, 1);
+    }
+    else {
+        glEnableVertexArrayAttrib(VAO, 1);
+    }
+    // LOD nodes carry their own scale in w; a 3-component offset reads w = 1
+    if (mode == GasketMode::Lod) {
+        glVertexArrayAttribFormat(VAO, 2, 4, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayVertexBuffer(VAO, 2, entry.VBO_Offset, 0, sizeof(glm::vec4));
+    }
+    else {
+        glVertexArrayAttribFormat(VAO, 2, 3, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayVertexBuffer(VAO, 2, entry.VBO_Offset, 0, sizeof(glm::vec3));
+    }
+    if (mode == GasketMode::Instanced || mode == GasketMode::Lod) {
+        glEnableVertexArrayAttrib(VAO, 2);
+    }
+    else {
+        glDisableVertexArrayAttrib(VAO, 2);
+    }
+    if (format == VertexFormat::Lattice16) {
+        glEnableVertexArrayAttrib(VAO, 3);
+    }
+    else {
+        glDisableVertexArrayAttrib(VAO, 3);
+    }
+}
+
+size_t TetraGasket::buildUnits(const GasketLevel& out) {
+    // the units each stage advances by, see GasketGeometry and IfsEngine.h;
+    // packing counts one per 12 vertices, which is one per leaf of the tetrahedron.
+    // Lattice16 Triangles come out of the integer walk already packed.
+    size_t leaves = Ifs::leafCount(out.Shape, out.Level);
+    bool packs = out.Format != VertexFormat::Float32
+        && !(out.Mode == GasketMode::Triangles && out.Format == VertexFormat::Lattice16);
+    size_t packing = packs ? Ifs::vertexCount(out.Shape, out.Level) / GasketGeometry::VerticesPerTetra : 0;
+    switch (out.Mode) {
+    case GasketMode::Triangles:
+        return leaves + packing;
+    case GasketMode::Indexed:
+        return 5 * leaves + packing;
+    case GasketMode::Instanced:
+        return leaves;
+    default:
+        return 1;
+    }
+}
+
+void TetraGasket::produceLevel(GasketLevel& out, const GasketLevel* parent, ThreadPool* pool, BuildProgress* progress,
+    const std::string& diskCache) {
+    TRACE_ZONE("TetraGasket::produceLevel");
+    if (loadLevel(out, diskCache)) {
+        if (progress) progress->Done = progress->Total.load();
+    }
+    else {
+        buildLevel(out, parent, pool, progress);
+        saveLevel(out, diskCache);
+    }
+    buildMeshlets(out, pool);
+}
+
+void TetraGasket::buildMeshlets(GasketLevel& out, ThreadPool* pool) {
+    TRACE_ZONE("TetraGasket::buildMeshlets");
+    if (out.Mode != GasketMode::Triangles) return;
+    if (out.Shape == Fractal::Tetrahedron) {
+        Meshlets::buildGasket(out.Level, out.Meshlets);
+        return;
+    }
+
+    // other shapes read their own vertices; without a CPU-visible copy (Mapped path) they draw whole
+    const glm::vec3* positions = out.Positions.empty() ? nullptr : out.Positions.data();
+    if (!positions && out.Format == VertexFormat::Float32) {
+        positions = reinterpret_cast<const glm::vec3*>(out.FileStreams[GasketLevel::PositionStream]);
+    }
+    if (!positions) return;
+    size_t perLeaf = Ifs::vertexCount(out.Shape, 0);
+    Meshlets::build(positions, out.VertexCount, Meshlets::LeavesPerMeshlet * perLeaf, out.Meshlets,
+        out.Level >= ParallelMinLevel ? pool : nullptr);
+}
+
+bool TetraGasket::baked(const GasketLevel& out) {
+    return out.Shape == Fractal::Tetrahedron && out.Mode == GasketMode::Triangles && out.Level <= BakedGasket::MaxLevel;
+}
+
+bool TetraGasket::loadLevel(GasketLevel& out, const std::string& diskCache) {
+    TRACE_ZONE("TetraGasket::loadLevel");
+    // Procedural and LOD store next to nothing, so rebuilding them is cheaper than a file,
+    // and the baked levels are already in the binary
+    bool stored = (out.Mode == GasketMode::Triangles || out.Mode == GasketMode::Indexed || out.Mode == GasketMode::Instanced);
+    if (diskCache.empty() || !stored || baked(out)) return false;
+    if (!MeshFile::load(MeshFile::path(diskCache, out.Shape, out.Mode, out.Format, out.Level), out)) return false;
+
+    // on the Mapped path the blobs (or the decoded Lattice16 vertices) are copied straight into the mapped storage
+    void* mapped[GasketLevel::StreamCount] = { out.MappedPosition, out.MappedColor, out.MappedOffset, nullptr };
+    size_t expected[GasketLevel::StreamCount] = {};
+    if (out.Mode == GasketMode::Triangles) {
+        expected[GasketLevel::PositionStream] = out.VertexCount * VertexPacking::stride(out.Format);
+        expected[GasketLevel::ColorStream] = out.VertexCount * sizeof(glm::vec3);
+    }
+    else if (out.Mode == GasketMode::Instanced) {
+        expected[GasketLevel::OffsetStream] = out.InstanceCount * sizeof(glm::vec3);
+    }
+    const void* data[GasketLevel::StreamCount];
+    size_t bytes[GasketLevel::StreamCount];
+    for (int i = 0; i < GasketLevel::StreamCount; ++i) {
+        out.streamData(i, data[i], bytes[i]);
+        if (mapped[i] && bytes[i] != expected[i]) {
+            out.File.close();
+            std::fill(std::begin(out.FileStreams), std::end(out.FileStreams), nullptr);
+            out.Packed.clear();
+            return false;
+        }
+    }
+    bool fileNeeded = false;
+    for (int i = 0; i < GasketLevel::StreamCount; ++i) {
+        if (mapped[i]) {
+            std::memcpy(mapped[i], data[i], bytes[i]);
+            out.FileStreams[i] = nullptr;
+            out.FileStreamBytes[i] = 0;
+            if (i == GasketLevel::PositionStream) {
+                out.Packed.clear();
+                out.Packed.shrink_to_fit();
+            }
+        }
+        fileNeeded = fileNeeded || out.FileStreams[i];
+    }
+    if (!fileNeeded) out.File.close();
+    return true;
+}
+
+void TetraGasket::saveLevel(const GasketLevel& out, const std::string& diskCache) {
+    TRACE_ZONE("TetraGasket::saveLevel");
+    bool stored = (out.Mode == GasketMode::Triangles || out.Mode == GasketMode::Indexed || out.Mode == GasketMode::Instanced);
+    if (diskCache.empty() || !stored || baked(out)) return;
+
+    // a missing cache file only costs the next launch a rebuild
+    try {
+        MeshFile::write(MeshFile::path(diskCache, out.Shape, out.Mode, out.Format, out.Level), out);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Warning: " << e.what() << std::endl;
+    }
+}
+
+void TetraGasket::buildLevel(GasketLevel& out, const GasketLevel* parent, ThreadPool* pool, BuildProgress* progress) {
+    TRACE_ZONE("TetraGasket::buildLevel");
+    if (out.Mode != GasketMode::Lod && (out.Level < 0 || out.Level > gasketModeMaxLevel(out.Mode))) {
+        throw std::invalid_argument(std::string(gasketModeName(out.Mode)) + " subdivision level out of range: "
+            + std::to_string(out.Level));
+    }
+    if (out.Level > fractalMaxLevel(out.Shape)) {
+        throw std::invalid_argument(std::string(fractalName(out.Shape)) + " subdivision level out of range: "
+            + std::to_string(out.Level));
+    }
+
+    switch (out.Mode) {
+    case GasketMode::Indexed:
+        buildIndexed(out, progress);
+        break;
+    case GasketMode::Instanced:
+        buildInstanced(out, parent);
+        break;
+    case GasketMode::Procedural:
+        buildProcedural(out);
+        break;
+    case GasketMode::Lod:
+        // same base tetra as Instanced; the node list is filled by updateView()
+        buildBaseTetra(out);
+        break;
+    case GasketMode::Chunked:
+        // nothing up front: the chunks are generated as the view needs them
+        out.VertexCount = GasketGeometry::vertexCount(out.Level);
+        break;
+    default:
+        buildTriangles(out, parent, pool, progress);
+        break;
+    }
+    if (progress) progress->Done = progress->Total.load();
 }
 
-void TetraGasket::generate(int level) {
-    Positions.clear();
-    Colors.clear();
+void TetraGasket::buildTriangles(GasketLevel& out, const GasketLevel* parent, ThreadPool* pool, BuildProgress* progress) {
+    // output size is known up front: allocate once, then write every leaf in place
+    int level = out.Level;
+    out.VertexCount = Ifs::vertexCount(out.Shape, level);
 
-    dividePyramid(baseVertices[0], baseVertices[1], baseVertices[2], baseVertices[3], level);
+    // the low levels were generated by the compiler; Float32 uploads them straight from the tables
+    const void* bakedPositions = nullptr;
+    const void* bakedColors = nullptr;
+    bool fromTables = baked(out) && BakedGasket::find(level, bakedPositions, bakedColors);
+    size_t floatBytes = out.VertexCount * sizeof(glm::vec3);
+    if (fromTables && out.Format == VertexFormat::Float32 && !out.MappedPosition) {
+        out.FileStreams[GasketLevel::PositionStream] = static_cast<const uint8_t*>(bakedPositions);
+        out.FileStreams[GasketLevel::ColorStream] = static_cast<const uint8_t*>(bakedColors);
+        out.FileStreamBytes[GasketLevel::PositionStream] = floatBytes;
+        out.FileStreamBytes[GasketLevel::ColorStream] = floatBytes;
+        return;
+    }
 
-    VertexCount = Positions.size();
+    // Lattice16 is the integer walk itself: no float vertices, no packing pass
+    if (out.Format == VertexFormat::Lattice16) {
+        buildLattice16(out, pool, progress);
+        return;
+    }
 
-    if (VertexCount > 0) {
-        glNamedBufferData(VBO_Position, VertexCount * sizeof(glm::vec3), Positions.data(), GL_DYNAMIC_DRAW);
-        glNamedBufferData(VBO_Color, VertexCount * sizeof(glm::vec3), Colors.data(), GL_DYNAMIC_DRAW);
+    // Float32 on the Mapped path goes straight into the GL buffers, with no CPU copy at all
+    glm::vec3* positions;
+    glm::vec3* colors;
+    if (out.MappedPosition && out.Format == VertexFormat::Float32) {
+        positions = static_cast<glm::vec3*>(out.MappedPosition);
+        colors = static_cast<glm::vec3*>(out.MappedColor);
+    }
+    else {
+        out.Positions.resize(out.VertexCount);
+        out.Colors.resize(out.VertexCount);
+        positions = out.Positions.data();
+        colors = out.Colors.data();
+    }
+
+    // the tetrahedron refines its cached parent level; the other shapes always walk from the root
+    bool parallel = pool && level >= ParallelMinLevel;
+    if (out.Shape != Fractal::Tetrahedron) {
+        Ifs::generate(out.Shape, level, positions, colors, parallel ? pool : nullptr, progress);
+    }
+    else if (fromTables) {
+        std::memcpy(positions, bakedPositions, floatBytes);
+        std::memcpy(colors, bakedColors, floatBytes);
+    }
+    else if (parent && parallel) {
+        GasketGeometry::refine(level - 1, parent->Positions.data(), positions, colors, *pool, progress);
+    }
+    else if (parent) {
+        GasketGeometry::refine(level - 1, parent->Positions.data(), positions, colors);
     }
+    else if (parallel) {
+        GasketGeometry::generate(level, positions, colors, *pool, progress);
+    }
+    else {
+        GasketGeometry::generate(level, positions, colors);
+    }
+
+    packVertices(out, progress);
 }
 
-void TetraGasket::dividePyramid(const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3, const glm::vec3& v4, int level) {
-    if (level == 0) {
-        drawTetra(v1, v2, v3, v4);
-    } else {
-		// calculate midpoints of each edge
-        glm::vec3 m12 = 0.5f * (v1 + v2);
-        glm::vec3 m13 = 0.5f * (v1 + v3);
-        glm::vec3 m14 = 0.5f * (v1 + v4);
-        glm::vec3 m23 = 0.5f * (v2 + v3);
-        glm::vec3 m24 = 0.5f * (v2 + v4);
-        glm::vec3 m34 = 0.5f * (v3 + v4);
+void TetraGasket::buildLattice16(GasketLevel& out, ThreadPool* pool, BuildProgress* progress) {
+    VertexPacking::Lattice16Vertex* vertices = static_cast<VertexPacking::Lattice16Vertex*>(out.MappedPosition);
+    if (!vertices) {
+        out.Packed.resize(out.VertexCount * sizeof(VertexPacking::Lattice16Vertex));
+        vertices = reinterpret_cast<VertexPacking::Lattice16Vertex*>(out.Packed.data());
+    }
 
-        dividePyramid(v1, m12, m13, m14, level - 1);
-        dividePyramid(m12, v2, m23, m24, level - 1);
-        dividePyramid(m13, m23, v3, m34, level - 1);
-        dividePyramid(m14, m24, m34, v4, level - 1);
+    if (pool && out.Level >= ParallelMinLevel) {
+        LatticeGeometry::generateLattice16(out.Level, vertices, *pool, progress);
+    }
+    else {
+        LatticeGeometry::generateLattice16(out.Level, vertices);
     }
+    out.LatticeScale = std::ldexp(1.0f, -out.Level);
 }
 
-void TetraGasket::drawTetra(const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3, const glm::vec3& v4) {
-    addTriangle(v1, v2, v3, faceColors[0]); // Red
-    addTriangle(v4, v3, v2, faceColors[3]); // Black
-    addTriangle(v1, v4, v2, faceColors[2]); // Blue
-    addTriangle(v1, v3, v4, faceColors[1]); // Green
+void TetraGasket::buildIndexed(GasketLevel& out, BuildProgress* progress) {
+    GasketGeometry::generateIndexed(out.Level, out.Positions, out.Colors, out.Indices, progress);
+    out.VertexCount = out.Positions.size();
+    out.IndexCount = out.Indices.size();
+
+    packVertices(out, progress);
 }
 
-void TetraGasket::addTriangle(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& color) {
-    Positions.push_back(p1);
-    Positions.push_back(p2);
-    Positions.push_back(p3);
+void TetraGasket::buildInstanced(GasketLevel& out, const GasketLevel* parent) {
+    // the 12-vertex base tetra, scaled by 2^-level in the shader
+    int level = out.Level;
+    buildBaseTetra(out);
 
-    Colors.push_back(color);
-    Colors.push_back(color);
-    Colors.push_back(color);
+    out.InstanceCount = GasketGeometry::tetraCount(level);
+    glm::vec3* offsets = static_cast<glm::vec3*>(out.MappedOffset);
+    if (!offsets) {
+        out.Offsets.resize(out.InstanceCount);
+        offsets = out.Offsets.data();
+    }
+    if (parent) {
+        GasketGeometry::refineOffsets(level - 1, parent->Offsets.data(), offsets);
+    }
+    else {
+        GasketGeometry::generateOffsets(level, offsets);
+    }
+    out.Scale = std::ldexp(1.0f, -level);
 }
 
-void TetraGasket::draw() {
-    if (VertexCount > 0) {
+void TetraGasket::buildProcedural(GasketLevel& out) {
+    int level = out.Level;
+    if (level < 0 || level > ProceduralMaxLevel) {
+        throw std::invalid_argument("Procedural subdivision level out of range: " + std::to_string(level));
+    }
+
+    // nothing is stored
+    out.VertexCount = GasketGeometry::VerticesPerTetra;
+    out.InstanceCount = GasketGeometry::tetraCount(level);
+    out.ProceduralLevel = level;
+}
+
+void TetraGasket::buildBaseTetra(GasketLevel& out) {
+    out.VertexCount = GasketGeometry::VerticesPerTetra;
+    out.Positions.resize(out.VertexCount);
+    out.Colors.resize(out.VertexCount);
+    GasketGeometry::emitTetra(GasketGeometry::baseVertices, out.Positions.data(), out.Colors.data());
+}
+
+void TetraGasket::packVertices(GasketLevel& out, BuildProgress* progress) {
+    TRACE_ZONE("TetraGasket::packVertices");
+    if (out.Format == VertexFormat::Float32) return;
+
+    // in slices of whole leaves, so a cancelled build does not have to finish packing
+    constexpr size_t Slice = GasketGeometry::VerticesPerTetra * 4096;
+    size_t stride = VertexPacking::stride(out.Format);
+    uint8_t* packed = static_cast<uint8_t*>(out.MappedPosition);
+    if (!packed) {
+        out.Packed.resize(out.VertexCount * stride);
+        packed = out.Packed.data();
+    }
+    for (size_t first = 0; first < out.VertexCount; first += Slice) {
+        size_t count = (out.VertexCount - first < Slice) ? out.VertexCount - first : Slice;
+        VertexPacking::pack(out.Format, out.Level, out.Positions.data() + first, out.Colors.data() + first, count,
+            packed + first * stride);
+        if (progress) progress->advance(count / GasketGeometry::VerticesPerTetra);
+    }
+
+    // packed in place: the float streams were only the input
+    if (out.MappedPosition) {
+        out.Positions.clear();
+        out.Positions.shrink_to_fit();
+        out.Colors.clear();
+        out.Colors.shrink_to_fit();
+    }
+
+    if (out.Format == VertexFormat::Lattice16) {
+        out.LatticeScale = std::ldexp(1.0f, -out.Level);
+    }
+}
+
+int TetraGasket::uploads(const GasketLevel& level, BufferUpload (&list)[4]) {
+    int count = 0;
+    for (int stream = 0; stream < GasketLevel::StreamCount; ++stream) {
+        const void* data;
+        size_t bytes;
+        level.streamData(stream, data, bytes);
+        if (bytes > 0) list[count++] = { stream, level.buffer(stream), data, bytes };
+    }
+    return count;
+}
+
+void TetraGasket::beginUpload(std::unique_ptr<GasketLevel> level) {
+    level->createBuffers();
+
+    // buffers get their storage in uploadSome(), right before their first slice
+    BufferUpload list[4];
+    int count = uploads(*level, list);
+    UploadTotalBytes = 0;
+    for (int i = 0; i < count; ++i) UploadTotalBytes += list[i].Bytes;
+    UploadedBytes = 0;
+    UploadAllocated = 0;
+    Uploading = std::move(level);
+}
+
+bool TetraGasket::uploadSome(size_t budget) {
+    TRACE_ZONE("GL upload");
+    BufferUpload list[4];
+    int count = uploads(*Uploading, list);
+
+    // UploadedBytes runs across the buffers in list order
+    size_t start = 0;
+    for (int i = 0; i < count && budget > 0; ++i) {
+        size_t end = start + list[i].Bytes;
+        if (UploadedBytes < end) {
+            if (UploadAllocated <= i) {
+                Uploading->bufferData(list[i].Stream, list[i].Bytes, nullptr, GL_STATIC_DRAW);
+                UploadAllocated = i + 1;
+            }
+            size_t offset = UploadedBytes - start;
+            size_t bytes = (list[i].Bytes - offset < budget) ? list[i].Bytes - offset : budget;
+            glNamedBufferSubData(list[i].Buffer, offset, bytes, static_cast<const uint8_t*>(list[i].Data) + offset);
+            UploadedBytes += bytes;
+            budget -= bytes;
+        }
+        start = end;
+    }
+    if (UploadedBytes < UploadTotalBytes) return false;
+
+    // the packed copy and the file mapping only existed for the upload
+    Uploading->Packed.clear();
+    Uploading->Packed.shrink_to_fit();
+    Uploading->File.close();
+    std::fill(std::begin(Uploading->FileStreams), std::end(Uploading->FileStreams), nullptr);
+    std::fill(std::begin(Uploading->FileStreamBytes), std::end(Uploading->FileStreamBytes), size_t(0));
+    return true;
+}
+
+void TetraGasket::updateView(const glm::mat4& view, const glm::mat4& projection, int viewportHeight) {
+    // chunks keep streaming in even while the view stands still; the pool is the build's while one runs
+    if (Current && Current->Chunks) {
+        Current->Chunks->update(view, projection, Building ? nullptr : ChunkPool);
+        return;
+    }
+    if (Current && !Current->Meshlets.empty()) {
+        // like the LOD cut, redone only when the camera moves
+        if (MeshletsDirty || view != MeshletView || projection != MeshletProjection) {
+            TRACE_ZONE("Meshlets::cull");
+            Meshlets::cull(Current->Meshlets, view, projection, MeshletFirst, MeshletCount);
+            MeshletVertices = std::accumulate(MeshletCount.begin(), MeshletCount.end(), size_t(0));
+            MeshletView = view;
+            MeshletProjection = projection;
+            MeshletsDirty = false;
+        }
+        return;
+    }
+    if (!Current || Current->Mode != GasketMode::Lod) return;
+
+    // the cut only depends on the view, so a still camera costs nothing
+    if (!LodDirty && view == LodViewMatrix && projection == LodProjection && viewportHeight == LodViewportHeight) {
+        return;
+    }
+    LodViewMatrix = view;
+    LodProjection = projection;
+    LodViewportHeight = viewportHeight;
+    LodDirty = false;
+
+    GasketGeometry::LodView lod = { view, projection, static_cast<float>(viewportHeight), LodPixelThreshold, LodMaxLevel };
+    GasketGeometry::selectLod(lod, LodNodes);
+
+    Current->InstanceCount = LodNodes.size();
+    size_t bytes = LodNodes.size() * sizeof(glm::vec4);
+    if (Upload == UploadPath::Mapped && bytes > 0) {
+        // write into a region no queued frame is reading, instead of orphaning a buffer every move
+        size_t offset = 0;
+        void* target = LodRing.acquire(bytes, offset);
+        std::memcpy(target, LodNodes.data(), bytes);
+        glVertexArrayVertexBuffer(VAO, 2, LodRing.buffer(), static_cast<GLintptr>(offset), sizeof(glm::vec4));
+        LodRingBound = true;
+    }
+    else {
+        Current->bufferData(GasketLevel::OffsetStream, bytes, LodNodes.data(), GL_STREAM_DRAW);
+        glVertexArrayVertexBuffer(VAO, 2, Current->VBO_Offset, 0, sizeof(glm::vec4));
+        LodRingBound = false;
+    }
+}
+
+void TetraGasket::draw(const Shader& shader) {
+    DrawnTriangles = 0;
+    if (!Current) return;
+    const GasketLevel& entry = *Current;
+
+    shader.setFloat(ScaleLocation, entry.Scale);
+    shader.setFloat(LatticeScaleLocation, entry.LatticeScale);
+    shader.setInt(LevelLocation, entry.ProceduralLevel);
+
+    if (entry.Chunks) {
+        glBindVertexArray(VAO);
+        DrawnTriangles = entry.Chunks->draw() / 3;
+        glBindVertexArray(0);
+    }
+    else if (entry.VertexCount > 0) {
         glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(VertexCount));
+        if (entry.Mode == GasketMode::Indexed) {
+            glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(entry.IndexCount), GL_UNSIGNED_INT, nullptr);
+            DrawnTriangles = entry.IndexCount / 3;
+        }
+        else if (entry.Mode == GasketMode::Instanced || entry.Mode == GasketMode::Procedural || entry.Mode == GasketMode::Lod) {
+            glDrawArraysInstanced(GL_TRIANGLES, 0, static_cast<GLsizei>(entry.VertexCount), static_cast<GLsizei>(entry.InstanceCount));
+            DrawnTriangles = entry.VertexCount / 3 * entry.InstanceCount;
+        }
+        else if (!entry.Meshlets.empty() && !MeshletsDirty) {
+            if (!MeshletFirst.empty()) {
+                glMultiDrawArrays(GL_TRIANGLES, MeshletFirst.data(), MeshletCount.data(), static_cast<GLsizei>(MeshletFirst.size()));
+            }
+            DrawnTriangles = MeshletVertices / 3;
+        }
+        else {
+            glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(entry.VertexCount));
+            DrawnTriangles = entry.VertexCount / 3;
+        }
         glBindVertexArray(0);
+
+        // the ring region just drawn from may not be rewritten before this fence
+        if (entry.Mode == GasketMode::Lod && LodRingBound) LodRing.fence();
     }
 }
 
 void TetraGasket::cleanup() {
-    if (VBO_Color != 0) glDeleteBuffers(1, &VBO_Color);
-    if (VBO_Position != 0) glDeleteBuffers(1, &VBO_Position);
+    // the cache owns every level's buffers
+    cancelBuild();
+    LodRing.release();
+    Current = nullptr;
+    Cache.clear();
     if (VAO != 0) glDeleteVertexArrays(1, &VAO);
-}
\ No newline at end of file
+    VAO = 0;
+}
+
+bool TetraGasket::takeBuildError(std::string& message) {
+    if (BuildError.empty()) return false;
+    message = std::move(BuildError);
+    BuildError.clear();
+    return true;
+}
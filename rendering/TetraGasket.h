@@ -2,31 +2,164 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include "BuildProgress.h"
+#include "ChunkedGeometry.h"
+#include "Fractal.h"
+#include "GasketMode.h"
+#include "GeometryCache.h"
+#include "MappedRing.h"
+#include "UploadPath.h"
+#include "VertexFormat.h"
+#include "../core/Shader.h"
+
+class ThreadPool;
+
 class TetraGasket {
 public:
-    void init();
-    void generate(int level); //  volume subdivision
-    void draw();
+    void init(const Shader& shader); // after shader is linked: looks up the uniforms draw() sets
+    void generate(int level, ThreadPool* pool = nullptr); //  volume subdivision, blocks until drawable
+    void generateAsync(int level, ThreadPool* pool = nullptr); // builds on a background thread, the current level keeps drawing
+    void preload(int level, ThreadPool* pool = nullptr); // like generate() for the current mode, but only fills the cache
+    void update(); // GL thread, once per frame: hands finished builds to the GPU a slice at a time
+    const char* buildStage() const; // "Generating" / "Uploading" / "Streaming", nullptr when idle
+    float buildProgress() const; // 0..1 within the current stage
+    bool takeBuildError(std::string& message); // once per failed background build, found by update()
+    void updateView(const glm::mat4& view, const glm::mat4& projection, int viewportHeight); // LOD / Chunked modes, every frame
+    void draw(const Shader& shader);
+    void setMode(GasketMode mode) { Mode = mode; } // takes effect on the next generate()
+    void setFractal(Fractal fractal) { Shape = fractal; } // next generate(); shapes other than the tetrahedron draw as Triangles
+    void setVertexFormat(VertexFormat format) { Format = format; } // Triangles / Indexed, next generate()
+    void setLodPixelThreshold(float pixels) {
+        if (pixels != LodPixelThreshold) { LodPixelThreshold = pixels; LodDirty = true; }
+    }
+    void setUploadPath(UploadPath path) { Upload = path; } // levels built from now on
+    void setCacheBudget(size_t bytes); // CPU + GPU bytes kept for levels other than the current one
+    void setChunkBudget(size_t bytes); // GPU bytes a Chunked level streams its chunks into
+    void setDiskCache(const std::string& directory) { DiskCache = directory; } // "" = off; levels built from now on
+    const GeometryCache& cache() const { return Cache; }
+    const GasketLevel* current() const { return Current; } // what draw() shows, nullptr before the first level
+    size_t drawnTriangles() const { return DrawnTriangles; } // by the last draw(), after culling
     void cleanup();
 
+    // CPU side of a build, safe on any thread and without a GL context (the benchmarks call it directly);
+    // parent is the cached level above, if any. Reads the level from the disk cache when it is there,
+    // otherwise builds it and writes it there; diskCache "" = neither.
+    static void produceLevel(GasketLevel& out, const GasketLevel* parent, ThreadPool* pool, BuildProgress* progress,
+        const std::string& diskCache);
+
 private:
-    // Volume Subdivision
-    void dividePyramid(const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3, const glm::vec3& v4, int level);
+    // a level being generated on its own thread; cancelled and joined when dropped.
+    // Only one runs at a time, since they share the thread pool.
+    struct PendingBuild {
+        ~PendingBuild();
+
+        std::thread Thread;
+        BuildProgress Progress;
+        std::unique_ptr<GasketLevel> Result;
+        GasketLevel* Source = nullptr; // pinned cache entry it refines
+        std::exception_ptr Error;
+        std::atomic<bool> Finished{ false };
+    };
+
+    // one buffer of a level and the CPU data that goes into it
+    struct BufferUpload {
+        int Stream;
+        GLuint Buffer;
+        const void* Data;
+        size_t Bytes;
+    };
+
+    // below this level splitting the work costs more than it saves
+    static constexpr int ParallelMinLevel = 6;
+
+    // bytes handed to the driver per frame while a background build uploads
+    static constexpr size_t UploadBytesPerFrame = size_t(32) << 20;
+
+    void configureAttributes();
+    void activate(GasketLevel* entry);
+    void cancelBuild(); // blocking: joins the running build
+    void startBuild(std::unique_ptr<GasketLevel> level, ThreadPool* pool);
+    bool pending(const GasketLevel& level) const;
+    std::unique_ptr<GasketLevel> newLevel(int level) const;
+    GasketLevel* refinementSource(const GasketLevel& out);
+    GasketLevel* buildNow(int level, ThreadPool* pool); // blocking build + upload into the cache
+    void mapStorage(GasketLevel& out); // GL thread, before the build; Mapped path only
 
-    // bjIøs@ӧ㪺|
-    void drawTetra(const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3, const glm::vec3& v4);
+    static bool loadLevel(GasketLevel& out, const std::string& diskCache);
+    static bool baked(const GasketLevel& out); // compiled in (BakedGasket.h), never read from or written to disk
+    static void saveLevel(const GasketLevel& out, const std::string& diskCache);
+    static void buildLevel(GasketLevel& out, const GasketLevel* parent, ThreadPool* pool, BuildProgress* progress);
+    static size_t buildUnits(const GasketLevel& out);
+    static void buildTriangles(GasketLevel& out, const GasketLevel* parent, ThreadPool* pool, BuildProgress* progress);
+    static void buildLattice16(GasketLevel& out, ThreadPool* pool, BuildProgress* progress); // Triangles, from LatticeGeometry
+    static void buildIndexed(GasketLevel& out, BuildProgress* progress);
+    static void buildInstanced(GasketLevel& out, const GasketLevel* parent);
+    static void buildProcedural(GasketLevel& out);
+    static void buildBaseTetra(GasketLevel& out);
+    static void packVertices(GasketLevel& out, BuildProgress* progress);
+    static void buildMeshlets(GasketLevel& out, ThreadPool* pool); // Triangles, after the vertices are built or loaded
 
-    // N@TΥ[J vector
-    void addTriangle(const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& color);
+    // GL side: create the level's buffers, then upload at most budget bytes per call
+    static int uploads(const GasketLevel& level, BufferUpload (&list)[4]);
+    void beginUpload(std::unique_ptr<GasketLevel> level);
+    bool uploadSome(size_t budget); // true once Uploading is complete
+
+    // gl_InstanceID is a signed 32-bit int, so 4^15 leaves is as far as one draw goes
+    static constexpr int ProceduralMaxLevel = 15;
+
+    // deepest level LOD mode refines to, whatever level is selected
+    static constexpr int LodMaxLevel = 12;
 
     GLuint VAO = 0;
-    GLuint VBO_Position = 0;
-    GLuint VBO_Color = 0;
 
-    std::vector<glm::vec3> Positions;
-    std::vector<glm::vec3> Colors;
+    // uniform locations in the linked program, looked up once by init()
+    GLint ScaleLocation = -1;
+    GLint LatticeScaleLocation = -1;
+    GLint LevelLocation = -1;
+
+    Fractal Shape = Fractal::Tetrahedron;
+    GasketMode Mode = GasketMode::Triangles;
+    VertexFormat Format = VertexFormat::Float32;
+    UploadPath Upload = UploadPath::Copy;
+    std::string DiskCache; // directory of MeshFile levels, empty = no disk cache
+    size_t ChunkBudget = ChunkedGeometry::DefaultBudget;
+    ThreadPool* ChunkPool = nullptr; // last pool handed to generate(), used while no build runs
+
+    GeometryCache Cache;
+    GasketLevel* Current = nullptr; // owned by Cache, what draw() shows
+
+    std::unique_ptr<PendingBuild> Building; // generating on the background thread, possibly cancelled
+    std::string BuildError; // why the last build failed, until takeBuildError()
+    std::unique_ptr<GasketLevel> Queued; // requested while a cancelled build winds down
+    ThreadPool* QueuedPool = nullptr;
+    std::unique_ptr<GasketLevel> Uploading; // generated, buffers being filled
+    size_t UploadedBytes = 0;
+    size_t UploadTotalBytes = 0;
+    int UploadAllocated = 0; // buffers given storage so far, in uploads() order
+
+    std::vector<glm::vec4> LodNodes; // LOD mode only
+    MappedRing LodRing; // LOD nodes on the Mapped path, rewritten while earlier frames may still read them
+    bool LodRingBound = false;
+
+    float LodPixelThreshold = 1.0f; // stop refining once a node's edge is shorter than this on screen
+    bool LodDirty = true;
+    glm::mat4 LodViewMatrix = glm::mat4(1.0f);
+    glm::mat4 LodProjection = glm::mat4(1.0f);
+    int LodViewportHeight = 0;
 
-    size_t VertexCount = 0;
-};
\ No newline at end of file
+    std::vector<int> MeshletFirst; // Triangles: the vertex ranges of the visible meshlets
+    std::vector<int> MeshletCount;
+    bool MeshletsDirty = true;
+    size_t MeshletVertices = 0; // sum of MeshletCount
+    size_t DrawnTriangles = 0;
+    glm::mat4 MeshletView = glm::mat4(1.0f);
+    glm::mat4 MeshletProjection = glm::mat4(1.0f);
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+// how generated vertex data reaches the GPU
+enum class UploadPath {
+    Copy,   // build into CPU vectors, then glNamedBufferSubData; the vectors stay for refinement
+    Mapped, // build straight into persistent-mapped buffers; no CPU copy of the mesh is kept
+    Count
+};
+
+inline const char* uploadPathName(UploadPath path) {
+    switch (path) {
+    case UploadPath::Copy: return "Copy (keeps CPU copy)";
+    case UploadPath::Mapped: return "Persistent mapped";
+    default: return "?";
+    }
+}
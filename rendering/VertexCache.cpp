@@ -0,0 +1,189 @@
+#include "VertexCache.h"
+#include "BuildProgress.h"
+
+#include <cmath>
+
+namespace VertexCache {
+
+namespace {
+    constexpr int CacheSize = OptimizerCacheSize;
+    constexpr float CacheDecayPower = 1.5f;
+    constexpr float LastTriScore = 0.75f;
+    constexpr float ValenceBoostScale = 2.0f;
+    constexpr float ValenceBoostPower = 0.5f;
+
+    float vertexScore(int cachePosition, uint32_t remaining) {
+        if (remaining == 0) return -1.0f; // no triangles left, never pick again
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                // used by the last triangle: fixed score so its neighbours do not win by default
+                score = LastTriScore;
+            }
+            else {
+                float scaler = 1.0f / (CacheSize - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+            }
+        }
+        // favour vertices with few triangles left, to finish them off
+        score += ValenceBoostScale * std::pow(static_cast<float>(remaining), -ValenceBoostPower);
+        return score;
+    }
+}
+
+void optimize(std::vector<uint32_t>& indices, size_t vertexCount, BuildProgress* progress) {
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) return;
+
+    // vertex -> triangles, as a CSR list; remaining[v] shrinks as triangles are emitted
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t v : indices) ++remaining[v];
+
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vScore[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<char> emitted(triCount, 0);
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    uint32_t cache[CacheSize + 3];
+    int cacheCount = 0;
+    size_t cursor = 0;
+    long long best = -1;
+
+    constexpr size_t ProgressStep = 4096;
+    for (size_t n = 0; n < triCount; ++n) {
+        if (progress && n % ProgressStep == ProgressStep - 1) progress->advance(ProgressStep);
+
+        // nothing in the cache has work left: continue with the next triangle in input order
+        if (best < 0) {
+            while (emitted[cursor]) ++cursor;
+            best = static_cast<long long>(cursor);
+        }
+
+        size_t t = static_cast<size_t>(best);
+        emitted[t] = 1;
+
+        uint32_t newCache[CacheSize + 3];
+        int newCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = indices[3 * t + k];
+            output.push_back(v);
+            newCache[newCount++] = v;
+
+            // drop t from the vertex's open triangles
+            uint32_t* list = &adjacency[offsets[v]];
+            for (uint32_t i = 0; i < remaining[v]; ++i) {
+                if (list[i] == t) {
+                    list[i] = list[remaining[v] - 1];
+                    break;
+                }
+            }
+            --remaining[v];
+        }
+
+        // LRU: the triangle's vertices move to the front, the rest shift back
+        for (int i = 0; i < cacheCount; ++i) {
+            uint32_t v = cache[i];
+            if (v != newCache[0] && v != newCache[1] && v != newCache[2]) {
+                newCache[newCount++] = v;
+            }
+        }
+
+        for (int i = 0; i < newCount; ++i) {
+            uint32_t v = newCache[i];
+            cachePosition[v] = (i < CacheSize) ? i : -1;
+            vScore[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+
+        // rescore the open triangles around the cache and pick the best one
+        best = -1;
+        float bestScore = -1.0f;
+        for (int i = 0; i < newCount; ++i) {
+            uint32_t v = newCache[i];
+            const uint32_t* list = &adjacency[offsets[v]];
+            for (uint32_t j = 0; j < remaining[v]; ++j) {
+                uint32_t u = list[j];
+                float score = vScore[indices[3 * u]] + vScore[indices[3 * u + 1]] + vScore[indices[3 * u + 2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = u;
+                }
+            }
+        }
+
+        cacheCount = (newCount < CacheSize) ? newCount : CacheSize;
+        for (int i = 0; i < cacheCount; ++i) cache[i] = newCache[i];
+    }
+
+    if (progress) progress->advance(triCount % ProgressStep);
+    indices.swap(output);
+}
+
+void orderByFirstUse(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& remap) {
+    const uint32_t unused = ~0u;
+    remap.assign(vertexCount, unused);
+
+    uint32_t next = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == unused) remap[index] = next++;
+        index = remap[index];
+    }
+    for (uint32_t& slot : remap) {
+        if (slot == unused) slot = next++;
+    }
+}
+
+double acmr(const std::vector<uint32_t>& indices, size_t, int cacheSize) {
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) return 0.0;
+
+    // most recently used first; a hit moves to the front, a miss pushes the last entry out
+    std::vector<uint32_t> cache;
+    cache.reserve(cacheSize);
+    size_t misses = 0;
+    for (uint32_t v : indices) {
+        size_t i = 0;
+        while (i < cache.size() && cache[i] != v) ++i;
+        if (i == cache.size()) {
+            ++misses;
+            if (cache.size() < static_cast<size_t>(cacheSize)) cache.push_back(v);
+            i = cache.size() - 1;
+        }
+        for (; i > 0; --i) cache[i] = cache[i - 1];
+        cache[0] = v;
+    }
+    return static_cast<double>(misses) / static_cast<double>(triCount);
+}
+
+double acmrFifo(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize) {
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) return 0.0;
+
+    // a vertex is cached if fewer than cacheSize misses happened since it was loaded
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    std::vector<char> seen(vertexCount, 0);
+    size_t misses = 0;
+    for (uint32_t v : indices) {
+        if (!seen[v] || misses - loadedAt[v] >= static_cast<size_t>(cacheSize)) {
+            seen[v] = 1;
+            loadedAt[v] = misses++;
+        }
+    }
+    return static_cast<double>(misses) / static_cast<double>(triCount);
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct BuildProgress;
+
+// Post-transform vertex cache helpers for indexed triangle lists.
+namespace VertexCache {
+    constexpr int OptimizerCacheSize = 32; // entries of the LRU cache optimize() scores for
+
+    // reorder triangles for a small LRU cache (Forsyth, "Linear-Speed Vertex Cache Optimisation");
+    // advances progress by one unit per triangle
+    void optimize(std::vector<uint32_t>& indices, size_t vertexCount, BuildProgress* progress = nullptr);
+
+    // renumber vertices in order of first use so vertex fetch walks memory forward;
+    // remap[old] = new, vertices must then be permuted the same way
+    void orderByFirstUse(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& remap);
+
+    // average cache miss ratio (vertex shader runs per triangle) for an LRU cache of cacheSize entries,
+    // by default the model optimize() works against
+    double acmr(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = OptimizerCacheSize);
+
+    // the same for a FIFO cache, closer to what fixed-function hardware had
+    double acmrFifo(const std::vector<uint32_t>& indices, size_t vertexCount, int cacheSize = 16);
+}
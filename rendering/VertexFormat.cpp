@@ -0,0 +1,107 @@
+#include "VertexFormat.h"
+#include "GasketGeometry.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace VertexPacking {
+
+namespace {
+    int16_t toSnorm16(float v) {
+        if (v > 1.0f) v = 1.0f;
+        if (v < -1.0f) v = -1.0f;
+        return static_cast<int16_t>(std::lround(v * 32767.0f));
+    }
+
+    uint8_t toUnorm8(float v) {
+        if (v > 1.0f) v = 1.0f;
+        if (v < 0.0f) v = 0.0f;
+        return static_cast<uint8_t>(std::lround(v * 255.0f));
+    }
+
+    uint16_t paletteIndex(const glm::vec3& color) {
+        for (uint16_t i = 0; i < 4; ++i) {
+            if (color == GasketGeometry::faceColors[i]) return i;
+        }
+        throw std::invalid_argument("Vertex color is not one of the gasket face colors");
+    }
+
+    // barycentric solve p - b0 = M * lambda, with M's columns b1 - b0, b2 - b0, b3 - b0
+    struct LatticeBasis {
+        double inverse[3][3];
+        glm::dvec3 origin;
+
+        LatticeBasis() {
+            const glm::vec3* b = GasketGeometry::baseVertices;
+            double m[3][3];
+            for (int col = 0; col < 3; ++col) {
+                for (int row = 0; row < 3; ++row) m[row][col] = double(b[col + 1][row]) - double(b[0][row]);
+            }
+            double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+                - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+                + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+            for (int r = 0; r < 3; ++r) {
+                for (int c = 0; c < 3; ++c) {
+                    // cofactor of m[c][r], i.e. the adjugate
+                    int r0 = (c + 1) % 3, r1 = (c + 2) % 3, c0 = (r + 1) % 3, c1 = (r + 2) % 3;
+                    inverse[r][c] = (m[r0][c0] * m[r1][c1] - m[r0][c1] * m[r1][c0]) / det;
+                }
+            }
+            origin = glm::dvec3(b[0].x, b[0].y, b[0].z);
+        }
+    };
+}
+
+size_t stride(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::Snorm16: return sizeof(Snorm16Vertex);
+    case VertexFormat::Lattice16: return sizeof(Lattice16Vertex);
+    default: return 2 * sizeof(glm::vec3);
+    }
+}
+
+void pack(VertexFormat format, int level, const glm::vec3* positions, const glm::vec3* colors, size_t count,
+    std::vector<uint8_t>& out) {
+    if (format == VertexFormat::Float32) {
+        throw std::invalid_argument("Float32 is uploaded as two plain streams, there is nothing to pack");
+    }
+    out.resize(count * stride(format));
+    pack(format, level, positions, colors, count, out.data());
+}
+
+void pack(VertexFormat format, int level, const glm::vec3* positions, const glm::vec3* colors, size_t count,
+    uint8_t* out) {
+    if (format == VertexFormat::Float32) {
+        throw std::invalid_argument("Float32 is uploaded as two plain streams, there is nothing to pack");
+    }
+
+    if (format == VertexFormat::Snorm16) {
+        Snorm16Vertex* v = reinterpret_cast<Snorm16Vertex*>(out);
+        for (size_t i = 0; i < count; ++i) {
+            v[i] = { toSnorm16(positions[i].x), toSnorm16(positions[i].y), toSnorm16(positions[i].z), 0,
+                toUnorm8(colors[i].x), toUnorm8(colors[i].y), toUnorm8(colors[i].z), 255 };
+        }
+        return;
+    }
+
+    if (level < 0 || level > LatticeMaxLevel) {
+        throw std::invalid_argument("Lattice16 supports levels up to " + std::to_string(LatticeMaxLevel));
+    }
+
+    // float positions sit within ~1e-7 of a lattice point, far below half a step (2^-level / 2)
+    static const LatticeBasis basis;
+    const double steps = std::ldexp(1.0, level);
+    Lattice16Vertex* v = reinterpret_cast<Lattice16Vertex*>(out);
+    for (size_t i = 0; i < count; ++i) {
+        glm::dvec3 d = glm::dvec3(positions[i].x, positions[i].y, positions[i].z) - basis.origin;
+        uint16_t k[3];
+        for (int a = 0; a < 3; ++a) {
+            double lambda = basis.inverse[a][0] * d.x + basis.inverse[a][1] * d.y + basis.inverse[a][2] * d.z;
+            k[a] = static_cast<uint16_t>(std::lround(lambda * steps));
+        }
+        v[i] = { k[0], k[1], k[2], paletteIndex(colors[i]) };
+    }
+}
+
+}
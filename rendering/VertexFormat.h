@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// GPU vertex layout for the Triangles and Indexed modes
+enum class VertexFormat {
+    Float32,   // two streams: vec3 position + vec3 color, 24 bytes
+    Snorm16,   // interleaved: snorm16 xyz (+ pad) + RGBA8 color, 12 bytes
+    Lattice16, // interleaved: uint16 lattice k1..k3 + uint16 palette index, 8 bytes (exact)
+    Count
+};
+
+inline const char* vertexFormatName(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::Float32: return "Float32 (24 B)";
+    case VertexFormat::Snorm16: return "Snorm16 + RGBA8 (12 B)";
+    case VertexFormat::Lattice16: return "Lattice16 + palette (8 B)";
+    default: return "?";
+    }
+}
+
+namespace VertexPacking {
+    struct Snorm16Vertex {
+        int16_t x, y, z, pad;
+        uint8_t r, g, b, a;
+    };
+
+    // position = baseVertices[0] + sum_i k_i / 2^level * (baseVertices[i] - baseVertices[0])
+    struct Lattice16Vertex {
+        uint16_t k1, k2, k3;
+        uint16_t palette; // index into faceColors
+    };
+
+    // lattice coordinates go up to 2^level and must fit 16 bits
+    constexpr int LatticeMaxLevel = 15;
+
+    size_t stride(VertexFormat format); // bytes per vertex on the GPU
+
+    // convert the float streams to an interleaved compact layout (Snorm16 or Lattice16);
+    // level is needed by Lattice16 only
+    void pack(VertexFormat format, int level, const glm::vec3* positions, const glm::vec3* colors, size_t count,
+        std::vector<uint8_t>& out);
+
+    // same, into count * stride(format) bytes at out (lets a caller pack in slices)
+    void pack(VertexFormat format, int level, const glm::vec3* positions, const glm::vec3* colors, size_t count,
+        uint8_t* out);
+}
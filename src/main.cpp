@@ -1,11 +1,72 @@
 #include "../core/Application.h"
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
-int main()
+namespace {
+    GasketMode parseMode(const std::string& name) {
+        const char* names[] = { "triangles", "indexed", "instanced", "procedural", "lod", "chunked" };
+        for (int i = 0; i < static_cast<int>(GasketMode::Count); ++i) {
+            if (name == names[i]) return static_cast<GasketMode>(i);
+        }
+        throw std::invalid_argument("Unknown mode '" + name + "' (triangles, indexed, instanced, procedural, lod, chunked)");
+    }
+
+    VertexFormat parseFormat(const std::string& name) {
+        const char* names[] = { "float32", "snorm16", "lattice16" };
+        for (int i = 0; i < static_cast<int>(VertexFormat::Count); ++i) {
+            if (name == names[i]) return static_cast<VertexFormat>(i);
+        }
+        throw std::invalid_argument("Unknown vertex format '" + name + "' (float32, snorm16, lattice16)");
+    }
+
+    // --headless [level] [frames] [width] [height] [--mode m] [--format f] [--samples n] [--orbit degrees]
+    //            [--report file.csv] [--dump file.png] [--dump-every n]
+    HeadlessSettings parseHeadless(int argc, char** argv) {
+        HeadlessSettings settings;
+        int* positional[] = { &settings.Level, &settings.Frames, &settings.Width, &settings.Height };
+        int count = 0;
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.compare(0, 2, "--") != 0) {
+                if (count == 4) throw std::invalid_argument("Unexpected argument '" + arg + "'");
+                *positional[count++] = std::stoi(arg);
+                continue;
+            }
+            if (i + 1 == argc) throw std::invalid_argument(arg + " needs a value");
+            std::string value = argv[++i];
+            if (arg == "--mode") settings.Mode = parseMode(value);
+            else if (arg == "--format") settings.Format = parseFormat(value);
+            else if (arg == "--samples") settings.Samples = std::stoi(value);
+            else if (arg == "--orbit") settings.OrbitDegrees = std::stof(value);
+            else if (arg == "--report") settings.ReportPath = value;
+            else if (arg == "--dump") settings.DumpPath = value;
+            else if (arg == "--dump-every") settings.DumpEvery = std::stoi(value);
+            else throw std::invalid_argument("Unknown option " + arg);
+        }
+        return settings;
+    }
+}
+
+int main(int argc, char** argv)
 {
     Application app;
 
     try {
+        // --raytrace / --raymarch <file.png|file.ppm> [level] [width] [height]: render on the CPU, no window
+        std::string option = argc >= 2 ? argv[1] : "";
+        if ((option == "--raytrace" || option == "--raymarch") && argc >= 3) {
+            int level = argc > 3 ? std::stoi(argv[3]) : 8;
+            int width = argc > 4 ? std::stoi(argv[4]) : 1280;
+            int height = argc > 5 ? std::stoi(argv[5]) : 720;
+            app.renderImage(argv[2], level, width, height, option == "--raymarch");
+            return EXIT_SUCCESS;
+        }
+        // --headless ...: the GL renderer into an offscreen framebuffer, per-frame CPU / GPU times as CSV
+        if (option == "--headless") {
+            app.runHeadless(parseHeadless(argc, argv));
+            return EXIT_SUCCESS;
+        }
         app.run();
     }
     catch (const std::exception& e) {
@@ -14,4 +75,4 @@ int main()
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,814 @@
+// CPU-only checks of the geometry pipeline, run by ctest. Like GeometryBench it needs no
+// window and no GL context: every GL call in the linked code sits behind buffers these checks never create.
+//
+//   GeometryTests [--filter text]
+//
+// Each case prints one line; the exit code is the number of failed checks, so 0 means everything passed.
+// Files are written under the system temp directory and removed afterwards.
+#include "../core/ThreadPool.h"
+#include "../rendering/BakedGasket.h"
+#include "../rendering/GasketGeometry.h"
+#include "../rendering/GeometryCache.h"
+#include "../rendering/IfsRules.h"
+#include "../rendering/ImageFile.h"
+#include "../rendering/LatticeGeometry.h"
+#include "../rendering/LeafKernel.h"
+#include "../rendering/MeshFile.h"
+#include "../rendering/TetraGasket.h"
+#include "../rendering/VertexCache.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    int Failures = 0;
+
+    // records a failed check, with the line it is on, and carries on with the rest of the case
+    void expect(bool condition, const char* what, int line) {
+        if (condition) return;
+        ++Failures;
+        std::printf("    FAILED line %d: %s\n", line, what);
+    }
+#define EXPECT(condition) expect((condition), #condition, __LINE__)
+
+    std::vector<char> readFile(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const std::string& path, const std::vector<char>& data) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    std::filesystem::path scratchDirectory() {
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "gasket-tests";
+        std::filesystem::remove_all(directory);
+        std::filesystem::create_directories(directory);
+        return directory;
+    }
+
+    std::unique_ptr<GasketLevel> makeLevel(Fractal shape, GasketMode mode, VertexFormat format, int level) {
+        auto out = std::make_unique<GasketLevel>();
+        out->Shape = shape;
+        out->Mode = mode;
+        out->Format = format;
+        out->Level = level;
+        return out;
+    }
+
+    template <typename T>
+    bool sameBytes(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+    }
+
+    // the Triangles streams of one level, as the serial generate() writes them
+    struct Mesh {
+        std::vector<glm::vec3> Positions;
+        std::vector<glm::vec3> Colors;
+
+        Mesh() = default;
+        explicit Mesh(int level) : Positions(GasketGeometry::vertexCount(level)), Colors(Positions.size()) {}
+    };
+
+    Mesh generated(int level) {
+        Mesh mesh(level);
+        GasketGeometry::generate(level, mesh.Positions.data(), mesh.Colors.data());
+        return mesh;
+    }
+
+    // --- dividePyramid against the recursive algorithm ---
+
+    // The original TetraGasket::dividePyramid / drawTetra / addTriangle, kept as the reference the
+    // explicit-stack walk and its SIMD leaf kernels must reproduce bit for bit.
+    void addTriangle(Mesh& out, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, const glm::vec3& color) {
+        out.Positions.push_back(p1);
+        out.Positions.push_back(p2);
+        out.Positions.push_back(p3);
+
+        out.Colors.push_back(color);
+        out.Colors.push_back(color);
+        out.Colors.push_back(color);
+    }
+
+    void drawTetra(Mesh& out, const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3, const glm::vec3& v4) {
+        const glm::vec3* faceColors = GasketGeometry::faceColors;
+        addTriangle(out, v1, v2, v3, faceColors[0]); // Red
+        addTriangle(out, v4, v3, v2, faceColors[3]); // Black
+        addTriangle(out, v1, v4, v2, faceColors[2]); // Blue
+        addTriangle(out, v1, v3, v4, faceColors[1]); // Green
+    }
+
+    void recursivePyramid(Mesh& out, const glm::vec3& v1, const glm::vec3& v2, const glm::vec3& v3, const glm::vec3& v4, int level) {
+        if (level == 0) {
+            drawTetra(out, v1, v2, v3, v4);
+            return;
+        }
+        glm::vec3 m12 = 0.5f * (v1 + v2);
+        glm::vec3 m13 = 0.5f * (v1 + v3);
+        glm::vec3 m14 = 0.5f * (v1 + v4);
+        glm::vec3 m23 = 0.5f * (v2 + v3);
+        glm::vec3 m24 = 0.5f * (v2 + v4);
+        glm::vec3 m34 = 0.5f * (v3 + v4);
+
+        recursivePyramid(out, v1, m12, m13, m14, level - 1);
+        recursivePyramid(out, m12, v2, m23, m24, level - 1);
+        recursivePyramid(out, m13, m23, v3, m34, level - 1);
+        recursivePyramid(out, m14, m24, m34, v4, level - 1);
+    }
+
+    void testDividePyramid() {
+        const glm::vec3* base = GasketGeometry::baseVertices;
+        for (int level = 0; level <= 8; ++level) {
+            Mesh reference;
+            recursivePyramid(reference, base[0], base[1], base[2], base[3], level);
+
+            Mesh walked(level);
+            GasketGeometry::dividePyramid(GasketGeometry::baseVertices, level, walked.Positions.data(), walked.Colors.data());
+            EXPECT(sameBytes(walked.Positions, reference.Positions));
+            EXPECT(sameBytes(walked.Colors, reference.Colors));
+        }
+    }
+
+    // --- Geometry counts ---
+
+    void testCounts() {
+        for (int level = 0; level <= 6; ++level) {
+            EXPECT(GasketGeometry::tetraCount(level) == size_t(1) << (2 * level));
+            EXPECT(GasketGeometry::vertexCount(level) == 12 * GasketGeometry::tetraCount(level));
+        }
+
+        for (int i = 0; i < static_cast<int>(Fractal::Count); ++i) {
+            Fractal shape = static_cast<Fractal>(i);
+            size_t children = Ifs::leafCount(shape, 1);
+            size_t perLeaf = Ifs::vertexCount(shape, 0);
+            EXPECT(Ifs::leafCount(shape, 0) == 1);
+            for (int level = 0; level <= 3; ++level) {
+                EXPECT(Ifs::vertexCount(shape, level) == Ifs::leafCount(shape, level) * perLeaf);
+                if (level > 0) EXPECT(Ifs::leafCount(shape, level) == Ifs::leafCount(shape, level - 1) * children);
+            }
+        }
+
+        // what produceLevel builds for each mode
+        const int level = 4;
+        auto triangles = makeLevel(Fractal::Tetrahedron, GasketMode::Triangles, VertexFormat::Float32, level);
+        TetraGasket::produceLevel(*triangles, nullptr, nullptr, nullptr, "");
+        EXPECT(triangles->VertexCount == GasketGeometry::vertexCount(level));
+        // low levels come straight from the baked tables, so count the streams rather than the vectors
+        const void* data;
+        size_t bytes;
+        triangles->streamData(GasketLevel::PositionStream, data, bytes);
+        EXPECT(bytes == triangles->VertexCount * sizeof(glm::vec3));
+        triangles->streamData(GasketLevel::ColorStream, data, bytes);
+        EXPECT(bytes == triangles->VertexCount * sizeof(glm::vec3));
+        EXPECT(triangles->Meshlets.size() == GasketGeometry::tetraCount(level) / Meshlets::LeavesPerMeshlet);
+
+        auto indexed = makeLevel(Fractal::Tetrahedron, GasketMode::Indexed, VertexFormat::Float32, level);
+        TetraGasket::produceLevel(*indexed, nullptr, nullptr, nullptr, "");
+        EXPECT(indexed->IndexCount == GasketGeometry::vertexCount(level));
+        EXPECT(indexed->VertexCount > 0 && indexed->VertexCount < indexed->IndexCount);
+        bool inRange = true;
+        for (uint32_t index : indexed->Indices) inRange = inRange && index < indexed->VertexCount;
+        EXPECT(inRange);
+
+        auto instanced = makeLevel(Fractal::Tetrahedron, GasketMode::Instanced, VertexFormat::Float32, level);
+        TetraGasket::produceLevel(*instanced, nullptr, nullptr, nullptr, "");
+        EXPECT(instanced->VertexCount == GasketGeometry::VerticesPerTetra);
+        EXPECT(instanced->InstanceCount == GasketGeometry::tetraCount(level));
+        EXPECT(instanced->Offsets.size() == instanced->InstanceCount);
+    }
+
+    // --- ThreadPool ---
+
+    void testPoolGenerate() {
+        for (unsigned threads : { 1u, 2u, 4u }) {
+            ThreadPool pool(threads);
+            for (int level = 0; level <= 9; ++level) {
+                Mesh serial = generated(level);
+                Mesh parallel(level);
+                GasketGeometry::generate(level, parallel.Positions.data(), parallel.Colors.data(), pool);
+                if (!sameBytes(parallel.Positions, serial.Positions) || !sameBytes(parallel.Colors, serial.Colors)) {
+                    std::printf("    %u threads, level %d differs from the serial walk\n", threads, level);
+                    EXPECT(false);
+                }
+            }
+        }
+    }
+
+    // a task's exception comes out of the wait() of its own batch, once, and nowhere else
+    void testPoolExceptions() {
+        ThreadPool pool(4);
+        ThreadPool::Batch failing, healthy;
+        std::atomic<int> failingRan{ 0 }, healthyRan{ 0 };
+        for (int i = 0; i < 16; ++i) {
+            pool.submit([&failingRan, i] {
+                ++failingRan;
+                if (i == 3) throw std::runtime_error("task 3");
+            }, failing);
+            pool.submit([&healthyRan] { ++healthyRan; }, healthy);
+        }
+
+        bool healthyThrew = false;
+        try {
+            pool.wait(healthy);
+        }
+        catch (...) {
+            healthyThrew = true;
+        }
+        EXPECT(!healthyThrew);
+        EXPECT(healthyRan == 16);
+
+        std::string message;
+        try {
+            pool.wait(failing);
+        }
+        catch (const std::runtime_error& e) {
+            message = e.what();
+        }
+        EXPECT(message == "task 3");
+        EXPECT(failingRan == 16); // the other tasks of the batch still ran
+
+        // the error was handed out: the batch is clean for its next round
+        pool.submit([] {}, failing);
+        bool threwAgain = false;
+        try {
+            pool.wait(failing);
+        }
+        catch (...) {
+            threwAgain = true;
+        }
+        EXPECT(!threwAgain);
+
+        bool forThrew = false;
+        try {
+            pool.parallelFor(8, [](size_t i) {
+                if (i == 5) throw std::runtime_error("body 5");
+            });
+        }
+        catch (const std::runtime_error&) {
+            forThrew = true;
+        }
+        EXPECT(forThrew);
+    }
+
+    // A level build and the GL thread's parallelFor share the pool: the parallelFor must finish while
+    // a task of the build is still running, as long as its own tasks are done.
+    void testPoolIndependentBatches() {
+        ThreadPool pool(2);
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool started = false, released = false;
+
+        ThreadPool::Batch build;
+        pool.submit([&] {
+            std::unique_lock<std::mutex> lock(mutex);
+            started = true;
+            cv.notify_all();
+            // gives up after a while, so a pool that waits across batches fails the check instead of hanging
+            cv.wait_for(lock, std::chrono::seconds(10), [&] { return released; });
+        }, build);
+        std::thread builder([&] { pool.wait(build); });
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return started; });
+        }
+
+        std::atomic<size_t> sum{ 0 };
+        pool.parallelFor(64, [&sum](size_t i) { sum += i; });
+        bool buildStillRunning;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            buildStillRunning = !released;
+            released = true;
+        }
+        cv.notify_all();
+        builder.join();
+
+        EXPECT(sum == 64 * 63 / 2);
+        EXPECT(buildStillRunning);
+    }
+
+    // Several threads submitting, waiting and failing batches at once, with tasks that submit more
+    // tasks of their own batch from a worker. Meant to be run under ThreadSanitizer as well.
+    void testPoolStress() {
+        ThreadPool pool(4);
+        const int Submitters = 4;
+        const int Rounds = 300;
+        std::atomic<int> wrong{ 0 };
+
+        auto submitter = [&](int id) {
+            for (int round = 0; round < Rounds; ++round) {
+                size_t count = 1 + (id * 31 + round * 7) % 64;
+                bool throws = round % 5 == id;
+                ThreadPool::Batch batch;
+                std::atomic<size_t> ran{ 0 };
+                for (size_t i = 0; i < count; ++i) {
+                    pool.submit([&pool, &batch, &ran, i, count, throws] {
+                        ++ran;
+                        if (i == 0) {
+                            for (int child = 0; child < 8; ++child) pool.submit([&ran] { ++ran; }, batch);
+                        }
+                        if (throws && i == count / 2) throw std::runtime_error("stress");
+                    }, batch);
+                }
+
+                bool threw = false;
+                try {
+                    pool.wait(batch);
+                }
+                catch (const std::runtime_error&) {
+                    threw = true;
+                }
+                if (ran != count + 8 || threw != throws) ++wrong;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int id = 1; id < Submitters; ++id) threads.emplace_back(submitter, id);
+        submitter(0);
+        for (int round = 0; round < Rounds; ++round) {
+            std::atomic<size_t> sum{ 0 };
+            pool.parallelFor(100, [&sum](size_t i) { sum += i; });
+            if (sum != 100 * 99 / 2) ++wrong;
+        }
+        for (std::thread& thread : threads) thread.join();
+        EXPECT(wrong == 0);
+    }
+
+    // --- LeafKernel against the scalar kernel ---
+
+    // Each SIMD kernel runs whole vectors of parents and finishes with a partial one. Counts 1 to
+    // 2 x Width (up to BatchCapacity, the most a batch holds) cover full, partial and mixed batches.
+    void testLeafKernels() {
+        LeafKernel::ParentBatch batch;
+        uint32_t seed = 12345;
+        auto next = [&seed] {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / float(1 << 24) * 2.0f - 1.0f;
+        };
+        for (int i = 0; i < 4; ++i) {
+            for (int n = 0; n < LeafKernel::BatchCapacity; ++n) {
+                batch.x[i][n] = next();
+                batch.y[i][n] = next();
+                batch.z[i][n] = next();
+            }
+        }
+
+        struct Candidate {
+            LeafKernel::Isa Isa;
+            int Width;
+        };
+        const Candidate candidates[] = {
+            { LeafKernel::Isa::SSE4, 4 },
+            { LeafKernel::Isa::AVX2, 8 },
+            { LeafKernel::Isa::AVX512, 16 },
+        };
+        const size_t floatsPerParent = LeafKernel::VerticesPerParent * 3;
+        const float Canary = -12345.0f;
+
+        for (const Candidate& candidate : candidates) {
+            LeafKernel::Kernel kernel = LeafKernel::kernel(candidate.Isa);
+            if (!kernel) {
+                std::printf("    %s: not supported here, skipped\n", LeafKernel::isaName(candidate.Isa));
+                continue;
+            }
+            std::printf("    %s\n", LeafKernel::isaName(candidate.Isa));
+
+            int maxCount = std::min(2 * candidate.Width, LeafKernel::BatchCapacity);
+            for (int count = 1; count <= maxCount; ++count) {
+                std::vector<float> expected(count * floatsPerParent);
+                LeafKernel::scalarKernel(batch, count, expected.data());
+
+                // one parent of canaries past the end: the kernel must not write beyond count parents
+                std::vector<float> actual((count + 1) * floatsPerParent, Canary);
+                kernel(batch, count, actual.data());
+                bool same = std::memcmp(actual.data(), expected.data(), expected.size() * sizeof(float)) == 0;
+                bool untouched = true;
+                for (size_t i = expected.size(); i < actual.size(); ++i) untouched = untouched && actual[i] == Canary;
+                if (!same || !untouched) {
+                    std::printf("    %s, %d parents: %s\n", LeafKernel::isaName(candidate.Isa), count,
+                        same ? "wrote past the batch" : "differs from the scalar kernel");
+                    EXPECT(false);
+                }
+            }
+        }
+    }
+
+    // --- VertexCache ACMR ---
+
+    void testVertexCache() {
+        auto indexed = makeLevel(Fractal::Tetrahedron, GasketMode::Indexed, VertexFormat::Float32, 5);
+        TetraGasket::produceLevel(*indexed, nullptr, nullptr, nullptr, "");
+
+        // 8 unique vertices per tetra make 2.0 the best any order can do; unshared vertices cost 3.0
+        double lru = VertexCache::acmr(indexed->Indices, indexed->VertexCount);
+        double fifo = VertexCache::acmrFifo(indexed->Indices, indexed->VertexCount);
+        std::printf("    ACMR %.3f (%d-entry LRU), %.3f (16-entry FIFO)\n", lru, VertexCache::OptimizerCacheSize, fifo);
+        EXPECT(lru >= 2.0 && lru < 2.1);
+        EXPECT(fifo >= 2.0 && fifo < 2.1);
+
+        std::vector<uint32_t> unshared(GasketGeometry::vertexCount(3));
+        for (size_t i = 0; i < unshared.size(); ++i) unshared[i] = static_cast<uint32_t>(i);
+        EXPECT(VertexCache::acmr(unshared, unshared.size()) == 3.0);
+
+        // an LRU cache keeps a vertex that is reused, a FIFO one drops it in insertion order
+        std::vector<uint32_t> reuse = { 0, 1, 2, 0, 3, 4, 0, 5, 6 };
+        EXPECT(VertexCache::acmr(reuse, 7, 3) < VertexCache::acmrFifo(reuse, 7, 3));
+    }
+
+    // --- Refining a cached level ---
+
+    // the cache builds L + 1 from L, so refine() must equal a fresh walk down from the root
+    void testRefine() {
+        ThreadPool pool(4);
+        for (int level = 0; level <= 7; ++level) {
+            Mesh parent = generated(level);
+            Mesh fresh = generated(level + 1);
+
+            Mesh serial(level + 1);
+            GasketGeometry::refine(level, parent.Positions.data(), serial.Positions.data(), serial.Colors.data());
+            Mesh parallel(level + 1);
+            GasketGeometry::refine(level, parent.Positions.data(), parallel.Positions.data(), parallel.Colors.data(), pool);
+            EXPECT(sameBytes(serial.Positions, fresh.Positions) && sameBytes(serial.Colors, fresh.Colors));
+            EXPECT(sameBytes(parallel.Positions, fresh.Positions) && sameBytes(parallel.Colors, fresh.Colors));
+
+            std::vector<glm::vec3> parentOffsets(GasketGeometry::tetraCount(level));
+            std::vector<glm::vec3> freshOffsets(GasketGeometry::tetraCount(level + 1)), refined(freshOffsets.size());
+            GasketGeometry::generateOffsets(level, parentOffsets.data());
+            GasketGeometry::generateOffsets(level + 1, freshOffsets.data());
+            GasketGeometry::refineOffsets(level, parentOffsets.data(), refined.data());
+            EXPECT(sameBytes(refined, freshOffsets));
+        }
+    }
+
+    // --- MeshFile round trip and load validation ---
+
+    bool sameStreams(const GasketLevel& a, const GasketLevel& b) {
+        for (int stream = 0; stream < GasketLevel::StreamCount; ++stream) {
+            const void* dataA;
+            const void* dataB;
+            size_t bytesA, bytesB;
+            a.streamData(stream, dataA, bytesA);
+            b.streamData(stream, dataB, bytesB);
+            if (bytesA != bytesB || (bytesA > 0 && std::memcmp(dataA, dataB, bytesA) != 0)) return false;
+        }
+        return true;
+    }
+
+    void testMeshFile() {
+        std::filesystem::path directory = scratchDirectory();
+        struct Variant {
+            Fractal Shape;
+            GasketMode Mode;
+            VertexFormat Format;
+            int Level;
+        };
+        const Variant variants[] = {
+            { Fractal::Tetrahedron, GasketMode::Triangles, VertexFormat::Float32, 5 },
+            { Fractal::Tetrahedron, GasketMode::Triangles, VertexFormat::Snorm16, 5 },
+            { Fractal::Tetrahedron, GasketMode::Triangles, VertexFormat::Lattice16, 5 },
+            { Fractal::Tetrahedron, GasketMode::Indexed, VertexFormat::Float32, 4 },
+            { Fractal::Tetrahedron, GasketMode::Instanced, VertexFormat::Float32, 5 },
+            { Fractal::Menger, GasketMode::Triangles, VertexFormat::Float32, 2 },
+        };
+
+        for (const Variant& v : variants) {
+            std::printf("    %s %s %s level %d\n", fractalName(v.Shape), gasketModeName(v.Mode), vertexFormatName(v.Format), v.Level);
+            auto built = makeLevel(v.Shape, v.Mode, v.Format, v.Level);
+            TetraGasket::produceLevel(*built, nullptr, nullptr, nullptr, directory.string());
+            std::string path = MeshFile::path(directory.string(), v.Shape, v.Mode, v.Format, v.Level);
+            EXPECT(std::filesystem::exists(path));
+
+            auto loaded = makeLevel(v.Shape, v.Mode, v.Format, v.Level);
+            EXPECT(MeshFile::load(path, *loaded));
+            EXPECT(loaded->VertexCount == built->VertexCount);
+            EXPECT(loaded->IndexCount == built->IndexCount);
+            EXPECT(loaded->InstanceCount == built->InstanceCount);
+            EXPECT(sameStreams(*built, *loaded));
+
+            // another level than the one in the file
+            auto otherLevel = makeLevel(v.Shape, v.Mode, v.Format, v.Level + 1);
+            EXPECT(!MeshFile::load(path, *otherLevel));
+
+            // each corruption must fail the load instead of handing GL short or out-of-range buffers
+            const std::vector<char> original = readFile(path);
+            MeshFile::Header header;
+            std::memcpy(&header, original.data(), sizeof(header));
+            auto rejects = [&](const char* name, const std::function<void(MeshFile::Header&, std::vector<char>&)>& corrupt) {
+                std::vector<char> data = original;
+                MeshFile::Header changed = header;
+                corrupt(changed, data);
+                std::memcpy(data.data(), &changed, sizeof(changed));
+                std::string corruptPath = path + "." + name;
+                writeFile(corruptPath, data);
+                auto level = makeLevel(v.Shape, v.Mode, v.Format, v.Level);
+                bool loads = MeshFile::load(corruptPath, *level);
+                if (loads) std::printf("    accepted: %s\n", name);
+                return !loads;
+            };
+            EXPECT(rejects("version", [](MeshFile::Header& h, std::vector<char>&) { h.Version += 1; }));
+            EXPECT(rejects("vertices", [](MeshFile::Header& h, std::vector<char>&) { h.VertexCount += GasketGeometry::VerticesPerTetra; }));
+            EXPECT(rejects("short", [](MeshFile::Header& h, std::vector<char>&) { h.StreamBytes[GasketLevel::PositionStream] -= 1; }));
+            EXPECT(rejects("misaligned", [](MeshFile::Header& h, std::vector<char>&) { h.StreamOffset[GasketLevel::PositionStream] += 4; }));
+            EXPECT(rejects("truncated", [](MeshFile::Header&, std::vector<char>& data) { data.resize(data.size() - 1); }));
+            if (v.Mode == GasketMode::Indexed) {
+                EXPECT(rejects("index", [&](MeshFile::Header& h, std::vector<char>& data) {
+                    uint32_t outside = static_cast<uint32_t>(h.VertexCount);
+                    std::memcpy(data.data() + h.StreamOffset[GasketLevel::IndexStream], &outside, sizeof(outside));
+                }));
+            }
+            if (v.Format == VertexFormat::Lattice16 && v.Mode == GasketMode::Triangles) {
+                // a first coordinate delta of 2^level + 1: beyond the lattice of this level
+                EXPECT(rejects("lattice", [&](MeshFile::Header& h, std::vector<char>& data) {
+                    uint8_t* stream = reinterpret_cast<uint8_t*>(data.data() + h.StreamOffset[GasketLevel::PositionStream]);
+                    uint32_t zigzag = 2 * ((1u << v.Level) + 1);
+                    stream[0] = static_cast<uint8_t>(zigzag);
+                }));
+            }
+        }
+        std::filesystem::remove_all(directory);
+    }
+
+    // --- IfsRules windings ---
+
+    // Back faces are culled, so every triangle must be counterclockwise seen from outside its leaf:
+    // its normal points away from the leaf's center. The Sierpinski triangle is flat and two-sided,
+    // so there each front face has a back face with the opposite normal instead.
+    void testWindings() {
+        for (int i = 0; i < static_cast<int>(Fractal::Count); ++i) {
+            Fractal shape = static_cast<Fractal>(i);
+            const int level = 1;
+            size_t perLeaf = Ifs::vertexCount(shape, 0);
+            std::vector<glm::vec3> positions(Ifs::vertexCount(shape, level)), colors(positions.size());
+            Ifs::generate(shape, level, positions.data(), colors.data());
+
+            bool outward = true, paired = true;
+            for (size_t first = 0; first < positions.size(); first += perLeaf) {
+                glm::vec3 center(0.0f);
+                for (size_t v = first; v < first + perLeaf; ++v) center += positions[v];
+                center = center * (1.0f / static_cast<float>(perLeaf));
+
+                for (size_t v = first; v < first + perLeaf; v += 3) {
+                    const glm::vec3* t = &positions[v];
+                    glm::vec3 normal = glm::cross(t[1] - t[0], t[2] - t[0]);
+                    if (shape == Fractal::Triangle) {
+                        if ((v - first) % 6 == 0) {
+                            const glm::vec3* back = t + 3;
+                            glm::vec3 backNormal = glm::cross(back[1] - back[0], back[2] - back[0]);
+                            paired = paired && glm::dot(normal, backNormal) < 0.0f;
+                        }
+                    }
+                    else {
+                        glm::vec3 middle = (t[0] + t[1] + t[2]) / 3.0f;
+                        outward = outward && glm::dot(normal, middle - center) > 0.0f;
+                    }
+                }
+            }
+            std::printf("    %s\n", fractalName(shape));
+            EXPECT(outward);
+            EXPECT(paired);
+        }
+    }
+
+    // --- Baked levels ---
+
+    void testBakedLevels() {
+        for (int level = 0; level <= BakedGasket::MaxLevel; ++level) {
+            const void* positions = nullptr;
+            const void* colors = nullptr;
+            EXPECT(BakedGasket::find(level, positions, colors));
+            if (!positions || !colors) continue;
+
+            Mesh mesh = generated(level);
+            size_t bytes = mesh.Positions.size() * sizeof(glm::vec3);
+            EXPECT(std::memcmp(positions, mesh.Positions.data(), bytes) == 0);
+            EXPECT(std::memcmp(colors, mesh.Colors.data(), bytes) == 0);
+        }
+        const void* positions;
+        const void* colors;
+        EXPECT(!BakedGasket::find(BakedGasket::MaxLevel + 1, positions, colors));
+    }
+
+    // --- LatticeGeometry varint stream ---
+
+    bool decodesTo(const std::vector<uint8_t>& stream, int level, const std::vector<LatticeGeometry::Tetra>& leaves) {
+        LatticeGeometry::Decoder decoder(stream.data(), stream.size(), level);
+        for (const LatticeGeometry::Tetra& leaf : leaves) {
+            LatticeGeometry::Tetra decoded;
+            if (!decoder.next(decoded) || std::memcmp(&decoded, &leaf, sizeof(leaf)) != 0) return false;
+        }
+        return decoder.finished();
+    }
+
+    void testLatticeVarint() {
+        const int level = 6;
+        std::vector<LatticeGeometry::Tetra> leaves(GasketGeometry::tetraCount(level));
+        LatticeGeometry::generate(level, leaves.data());
+        std::vector<uint8_t> stream;
+        LatticeGeometry::Encoder encoder(stream);
+        for (const LatticeGeometry::Tetra& leaf : leaves) encoder.add(leaf);
+
+        EXPECT(decodesTo(stream, level, leaves));
+        EXPECT(stream.size() < 16 * leaves.size()); // about 12 bytes per leaf
+        EXPECT(!decodesTo(stream, level - 1, leaves)); // corners beyond 2^(level - 1)
+
+        std::vector<uint8_t> truncated(stream.begin(), stream.end() - 1);
+        LatticeGeometry::Decoder decoder(truncated.data(), truncated.size(), level);
+        LatticeGeometry::Tetra leaf;
+        size_t decoded = 0;
+        while (decoder.next(leaf)) ++decoded;
+        EXPECT(decoded == leaves.size() - 1);
+
+        // a varint longer than any coordinate delta
+        std::vector<uint8_t> endless(8, 0xFF);
+        LatticeGeometry::Decoder overlong(endless.data(), endless.size(), level);
+        EXPECT(!overlong.next(leaf));
+
+        // the deepest Lattice16 level still round-trips its root
+        LatticeGeometry::Tetra root = LatticeGeometry::root(VertexPacking::LatticeMaxLevel);
+        std::vector<uint8_t> single;
+        LatticeGeometry::Encoder(single).add(root);
+        EXPECT(decodesTo(single, VertexPacking::LatticeMaxLevel, { root }));
+    }
+
+    // --- Lattice16 walk ---
+
+    // Lattice16 levels written to disk must not depend on how many threads built them,
+    // and must equal the packed float walk
+    void testLattice16() {
+        using VertexPacking::Lattice16Vertex;
+        for (int level = 0; level <= 8; ++level) {
+            std::vector<Lattice16Vertex> serial(GasketGeometry::vertexCount(level));
+            LatticeGeometry::generateLattice16(level, serial.data());
+
+            Mesh mesh = generated(level);
+            std::vector<uint8_t> packed;
+            VertexPacking::pack(VertexFormat::Lattice16, level, mesh.Positions.data(), mesh.Colors.data(), mesh.Positions.size(), packed);
+            EXPECT(packed.size() == serial.size() * sizeof(Lattice16Vertex)
+                && std::memcmp(packed.data(), serial.data(), packed.size()) == 0);
+
+            for (unsigned threads : { 1u, 2u, 4u }) {
+                ThreadPool pool(threads);
+                std::vector<Lattice16Vertex> parallel(serial.size());
+                LatticeGeometry::generateLattice16(level, parallel.data(), pool);
+                if (!sameBytes(parallel, serial)) {
+                    std::printf("    %u threads, level %d differs from the serial walk\n", threads, level);
+                    EXPECT(false);
+                }
+            }
+        }
+    }
+
+    // --- PNG checksums ---
+
+    uint32_t readBigEndian(const std::vector<char>& data, size_t at) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data()) + at;
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    }
+
+    // bit by bit, independent of ImageFile's table
+    uint32_t crc32(const uint8_t* data, size_t bytes) {
+        uint32_t c = 0xFFFFFFFFu;
+        for (size_t i = 0; i < bytes; ++i) {
+            c ^= data[i];
+            for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1)));
+        }
+        return c ^ 0xFFFFFFFFu;
+    }
+
+    uint32_t adler32(const std::vector<uint8_t>& data) {
+        uint32_t a = 1, b = 0;
+        for (uint8_t v : data) {
+            a = (a + v) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    void testPng() {
+        // known answers first
+        const char* text = "Wikipedia";
+        EXPECT(adler32(std::vector<uint8_t>(text, text + std::strlen(text))) == 0x11E60398u);
+        EXPECT(crc32(reinterpret_cast<const uint8_t*>("IEND"), 4) == 0xAE426082u);
+
+        // large enough for two stored deflate blocks
+        RgbImage image;
+        image.Width = 200;
+        image.Height = 120;
+        image.Pixels.resize(size_t(3) * image.Width * image.Height);
+        for (size_t i = 0; i < image.Pixels.size(); ++i) image.Pixels[i] = static_cast<uint8_t>(i * 7 + i / 600);
+
+        std::filesystem::path directory = scratchDirectory();
+        std::string path = (directory / "image.png").string();
+        ImageFile::writePng(path, image);
+        std::vector<char> file = readFile(path);
+        std::filesystem::remove_all(directory);
+
+        EXPECT(file.size() > 8 && std::memcmp(file.data(), "\x89PNG\r\n\x1a\n", 8) == 0);
+        std::vector<uint8_t> zlib;
+        bool checksums = true, ended = false;
+        for (size_t at = 8; at + 12 <= file.size();) {
+            uint32_t length = readBigEndian(file, at);
+            if (at + 12 + length > file.size()) break;
+            const uint8_t* type = reinterpret_cast<const uint8_t*>(file.data()) + at + 4;
+            checksums = checksums && crc32(type, 4 + length) == readBigEndian(file, at + 8 + length);
+            if (std::memcmp(type, "IDAT", 4) == 0) zlib.insert(zlib.end(), type + 4, type + 4 + length);
+            if (std::memcmp(type, "IEND", 4) == 0) ended = true;
+            at += 12 + length;
+        }
+        EXPECT(checksums);
+        EXPECT(ended);
+
+        // inflate the stored blocks by hand and check the scanlines and the Adler-32 trailer
+        std::vector<uint8_t> raw;
+        size_t at = 2;
+        bool last = false;
+        while (!last && at + 5 <= zlib.size()) {
+            last = (zlib[at] & 1) != 0;
+            size_t bytes = zlib[at + 1] | (size_t(zlib[at + 2]) << 8);
+            size_t complement = zlib[at + 3] | (size_t(zlib[at + 4]) << 8);
+            EXPECT((bytes ^ complement) == 0xFFFF);
+            raw.insert(raw.end(), zlib.begin() + at + 5, zlib.begin() + at + 5 + bytes);
+            at += 5 + bytes;
+        }
+        EXPECT(zlib.size() >= 6 && zlib[0] == 0x78 && (zlib[0] * 256 + zlib[1]) % 31 == 0);
+        EXPECT(last && at + 4 == zlib.size());
+        uint32_t trailer = at + 4 <= zlib.size()
+            ? (uint32_t(zlib[at]) << 24) | (uint32_t(zlib[at + 1]) << 16) | (uint32_t(zlib[at + 2]) << 8) | zlib[at + 3]
+            : 0;
+        EXPECT(trailer == adler32(raw));
+
+        size_t row = size_t(3) * image.Width;
+        bool pixels = raw.size() == (row + 1) * image.Height;
+        for (int y = 0; pixels && y < image.Height; ++y) {
+            pixels = raw[y * (row + 1)] == 0 && std::memcmp(&raw[y * (row + 1) + 1], &image.Pixels[y * row], row) == 0;
+        }
+        EXPECT(pixels);
+    }
+
+    struct Case {
+        const char* Name;
+        void (*Run)();
+    };
+}
+
+int main(int argc, char** argv) {
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+        else {
+            std::fprintf(stderr, "Usage: GeometryTests [--filter text]\n");
+            return 1;
+        }
+    }
+
+    const Case cases[] = {
+        { "divide-pyramid", testDividePyramid },
+        { "counts", testCounts },
+        { "pool-generate", testPoolGenerate },
+        { "pool-exceptions", testPoolExceptions },
+        { "pool-independent-batches", testPoolIndependentBatches },
+        { "pool-stress", testPoolStress },
+        { "leaf-kernels", testLeafKernels },
+        { "vertex-cache", testVertexCache },
+        { "refine", testRefine },
+        { "mesh-file", testMeshFile },
+        { "windings", testWindings },
+        { "baked-levels", testBakedLevels },
+        { "lattice-varint", testLatticeVarint },
+        { "lattice16", testLattice16 },
+        { "png", testPng },
+    };
+    for (const Case& c : cases) {
+        if (!filter.empty() && std::string(c.Name).find(filter) == std::string::npos) continue;
+        int before = Failures;
+        std::printf("%s\n", c.Name);
+        try {
+            c.Run();
+        }
+        catch (const std::exception& e) {
+            ++Failures;
+            std::printf("    FAILED: %s\n", e.what());
+        }
+        std::printf("  %s\n", Failures == before ? "ok" : "FAILED");
+    }
+    std::printf("%d failed check(s)\n", Failures);
+    return Failures;
+}